@@ -0,0 +1,180 @@
+#include "BenchHarness.h"
+#include "../include/json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+using json = nlohmann::json;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedNs(const BenchHarness::Body &body, std::size_t iterations) {
+    Clock::time_point start = Clock::now();
+    body(iterations);
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+} // namespace
+
+BenchHarness::BenchHarness(const Options &options) : options(options), cases() {}
+
+bool BenchHarness::parseOptions(int argc, char *argv[], Options &options, std::string &error) {
+    for (int i = 1; i < argc; i++) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            error = flag + " needs a value";
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (flag == "--repetitions") options.repetitions = std::max<std::size_t>(std::stoul(value), 1);
+            else if (flag == "--min-time") options.minBatchMs = std::stod(value);
+            else if (flag == "--warmup") options.warmupMs = std::stod(value);
+            else if (flag == "--threshold") options.threshold = std::stod(value) / 100;
+            else if (flag == "--filter") options.filter = value;
+            else if (flag == "--json") options.jsonPath = value;
+            else if (flag == "--baseline") options.baselinePath = value;
+            else {
+                error = "unknown flag " + flag;
+                return false;
+            }
+        } catch (const std::exception &) {
+            error = "invalid value for " + flag + ": " + value;
+            return false;
+        }
+    }
+    return true;
+}
+
+void BenchHarness::add(const std::string &name, const std::string &input, std::size_t bytesPerOp, Body body) {
+    cases.push_back(Case{name, input, bytesPerOp, body});
+}
+
+BenchHarness::Result BenchHarness::measure(const Case &benchCase) const {
+    // Double the batch until it is long enough to time; this also starts the warm-up
+    std::size_t iterations = 1;
+    double batchNs = elapsedNs(benchCase.body, iterations);
+    while (batchNs < options.minBatchMs * 1e6 && iterations < (std::size_t(1) << 40)) {
+        iterations *= 2;
+        batchNs = elapsedNs(benchCase.body, iterations);
+    }
+    for (double warmedNs = 0; warmedNs < options.warmupMs * 1e6;) {
+        warmedNs += elapsedNs(benchCase.body, iterations);
+    }
+
+    std::vector<double> samples;
+    for (std::size_t i = 0; i < options.repetitions; i++) {
+        samples.push_back(elapsedNs(benchCase.body, iterations) / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    Result result = {benchCase.name, benchCase.input, benchCase.bytesPerOp, iterations, 0, 0, 0, 0, 0};
+    std::size_t count = samples.size();
+    result.min = samples.front();
+    result.max = samples.back();
+    result.median = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) / 2;
+    for (double sample : samples) {
+        result.mean += sample / count;
+    }
+    for (double sample : samples) {
+        result.stddev += (sample - result.mean) * (sample - result.mean);
+    }
+    result.stddev = count > 1 ? std::sqrt(result.stddev / (count - 1)) : 0;
+    return result;
+}
+
+int BenchHarness::run() {
+    // Medians of the baseline run by "name/input"
+    std::map<std::string, double> baseline;
+    if (!options.baselinePath.empty()) {
+        std::ifstream file(options.baselinePath.c_str());
+        try {
+            json data = json::parse(file);
+            for (const json &entry : data["results"]) {
+                baseline[entry["name"].get<std::string>() + "/" + entry["input"].get<std::string>()] =
+                    entry["ns_per_op"]["median"].get<double>();
+            }
+        } catch (const std::exception &) {
+            std::cerr << "Could not read baseline " << options.baselinePath << std::endl;
+            return 1;
+        }
+    }
+
+    std::printf("%-28s %-14s %12s %8s %12s %10s %s\n", "benchmark", "input", "median ns", "stddev", "min ns", "MB/s",
+                baseline.empty() ? "" : "vs baseline");
+    std::vector<Result> results;
+    int regressions = 0;
+    for (const Case &benchCase : cases) {
+        std::string key = benchCase.name + "/" + benchCase.input;
+        if (key.find(options.filter) == std::string::npos) continue;
+
+        std::streambuf *console = std::cout.rdbuf(nullptr); // Bodies may print per call
+        Result result = measure(benchCase);
+        std::cout.rdbuf(console);
+        std::cout.clear();
+        results.push_back(result);
+
+        char throughput[32] = "-";
+        if (result.bytesPerOp > 0) {
+            std::snprintf(throughput, sizeof(throughput), "%.1f", result.bytesPerOp * 1e3 / result.median);
+        }
+        std::string comparison;
+        std::map<std::string, double>::const_iterator base = baseline.find(key);
+        if (base != baseline.end()) {
+            double change = result.median / base->second - 1;
+            char text[64];
+            std::snprintf(text, sizeof(text), "%+.1f%%", change * 100);
+            comparison = text;
+            if (change > options.threshold) {
+                comparison += " REGRESSION";
+                regressions++;
+            } else if (change < -options.threshold) {
+                comparison += " faster";
+            }
+        } else if (!baseline.empty()) {
+            comparison = "new";
+        }
+        std::printf("%-28s %-14s %12.1f %7.1f%% %12.1f %10s %s\n", result.name.c_str(), result.input.c_str(),
+                    result.median, result.median > 0 ? result.stddev * 100 / result.median : 0.0, result.min,
+                    throughput, comparison.c_str());
+        std::fflush(stdout);
+    }
+
+    if (!options.jsonPath.empty()) {
+        json data;
+        data["repetitions"] = options.repetitions;
+        data["min_batch_ms"] = options.minBatchMs;
+        data["results"] = json::array();
+        for (const Result &result : results) {
+            data["results"].push_back({{"name", result.name},
+                                       {"input", result.input},
+                                       {"iterations", result.iterations},
+                                       {"bytes_per_op", result.bytesPerOp},
+                                       {"ns_per_op", {{"min", result.min},
+                                                      {"median", result.median},
+                                                      {"mean", result.mean},
+                                                      {"stddev", result.stddev},
+                                                      {"max", result.max}}}});
+        }
+        std::ofstream out(options.jsonPath.c_str());
+        out << data.dump(2) << "\n";
+        out.close();
+        if (!out) {
+            std::cerr << "Could not write " << options.jsonPath << std::endl;
+            return 1;
+        }
+        std::cout << results.size() << " results written to " << options.jsonPath << std::endl;
+    }
+    if (regressions > 0) {
+        std::cout << regressions << " regressions over " << options.threshold * 100 << "% against "
+                  << options.baselinePath << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+// Microbenchmark runner. Each case is a body that performs its operation a given number of
+// times. A case is calibrated until one batch takes at least the minimum time, warmed up,
+// then timed for a number of repetitions; the summary (min, median, mean, standard deviation,
+// max in ns per operation) is printed, optionally written as JSON, and optionally compared
+// with the JSON of an earlier run, where a median slower by more than the threshold counts
+// as a regression. std::cout is muted while a body runs.
+class BenchHarness
+{
+public:
+    typedef std::function<void(std::size_t iterations)> Body;
+
+    struct Options {
+        std::size_t repetitions;
+        double minBatchMs;   // Calibrated batch length
+        double warmupMs;     // Untimed batches before the repetitions
+        double threshold;    // Relative median slowdown reported as a regression
+        std::string filter;  // Runs only cases whose "name/input" contains it
+        std::string jsonPath;
+        std::string baselinePath;
+    };
+
+    explicit BenchHarness(const Options &options);
+
+    // Reads --repetitions, --min-time (ms), --warmup (ms), --threshold (%), --filter, --json
+    // and --baseline; false with a message on an unknown flag or a bad value.
+    static bool parseOptions(int argc, char *argv[], Options &options, std::string &error);
+
+    // bytesPerOp > 0 adds a throughput column.
+    void add(const std::string &name, const std::string &input, std::size_t bytesPerOp, Body body);
+
+    int run(); // 0, or 1 if the baseline comparison found a regression or a file failed
+
+private:
+    struct Case {
+        std::string name;
+        std::string input;
+        std::size_t bytesPerOp;
+        Body body;
+    };
+
+    struct Result {
+        std::string name;
+        std::string input;
+        std::size_t bytesPerOp;
+        std::size_t iterations; // Per repetition
+        double min, median, mean, stddev, max;
+    };
+
+    Options options;
+    std::vector<Case> cases;
+
+    Result measure(const Case &benchCase) const;
+};
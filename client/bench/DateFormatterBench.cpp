@@ -0,0 +1,72 @@
+#include "../include/DateFormatter.h"
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Compares DateFormatter with the previous std::localtime + std::put_time path.
+// Usage: DateFormatterBench [count]
+
+// The formatting path epochToDate used before DateFormatter.
+static std::string legacyEpochToDate(int epochTime) {
+    std::time_t time = static_cast<std::time_t>(epochTime);
+    std::tm *tm = std::localtime(&time);
+    std::ostringstream oss;
+    oss << std::put_time(tm, "%d/%m/%y %H:%M");
+    return oss.str();
+}
+
+template <typename F>
+static double nanosPerCall(const std::vector<int> &times, F formatter, std::size_t &checksum) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < times.size(); i++) {
+        checksum += formatter(times[i])[9];
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / times.size();
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    // Sorted times spread over two years (the summary order), and random times.
+    std::vector<int> sorted(count), shuffled(count);
+    std::srand(42);
+    for (std::size_t i = 0; i < count; i++) {
+        sorted[i] = 1700000000 + static_cast<int>(i * (63072000.0 / count));
+        shuffled[i] = 1700000000 + std::rand() % 63072000;
+    }
+
+    // Verify both paths agree before timing them.
+    for (std::size_t i = 0; i < count; i += 7) {
+        if (legacyEpochToDate(shuffled[i]) != DateFormatter::format(shuffled[i])) {
+            std::cerr << "Mismatch at " << shuffled[i] << ": " << legacyEpochToDate(shuffled[i])
+                      << " vs " << DateFormatter::format(shuffled[i]) << std::endl;
+            return 1;
+        }
+    }
+
+    std::size_t checksum = 0;
+    std::string (*fast)(int) = &DateFormatter::format;
+    std::cout << "events: " << count << std::endl;
+    std::cout << "sorted   localtime+put_time: " << nanosPerCall(sorted, legacyEpochToDate, checksum) << " ns/call" << std::endl;
+    std::cout << "sorted   DateFormatter:      " << nanosPerCall(sorted, fast, checksum) << " ns/call" << std::endl;
+    std::cout << "shuffled localtime+put_time: " << nanosPerCall(shuffled, legacyEpochToDate, checksum) << " ns/call" << std::endl;
+    std::cout << "shuffled DateFormatter:      " << nanosPerCall(shuffled, fast, checksum) << " ns/call" << std::endl;
+
+    char buffer[DateFormatter::LENGTH];
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; i++) {
+        DateFormatter::format(sorted[i], buffer);
+        checksum += buffer[13];
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    std::cout << "sorted   DateFormatter (into buffer): "
+              << std::chrono::duration<double, std::nano>(end - start).count() / count << " ns/call" << std::endl;
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "../include/EventStore.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+// Stores received-style events with a TTL that keeps the newest half, then drops the channel.
+// Prints RSS growth against the store's live bytes for one storage mode (a fresh process per
+// mode, since freed heap memory is not returned to the system).
+// Usage: EventArenaBench [heap|arena|huge] [count]
+
+static std::size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    std::size_t pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    std::string mode = argc > 1 ? argv[1] : "arena";
+    std::size_t count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    const std::size_t MiB = 1 << 20;
+
+    std::size_t before = residentBytes();
+    EventStore store;
+    store.setArena(mode != "heap", mode == "huge");
+    store.setTtl(static_cast<long long>(count / 2));
+    InternId channel = StringInterner::instance().intern("police");
+    const std::string headers = "MESSAGE\nsubscription:78\nmessage-id:20\ndestination:/police\n\n";
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; i++) {
+        std::string frame = headers + "user:dispatcher_" + std::to_string(i % 50) + "\ncity:Liberty City\n"
+                            "event name:Fire\ndate time:" + std::to_string(i) + "\ngeneral information:\n"
+                            " active:true\n forces_arrival_at_scene:false\ndescription:\n" + std::string(40 + i % 80, 'x') + "\n";
+        FrameRef received(FrameBuffer::create(frame.data(), frame.size()));
+        Event event(received, StringRef(received->data() + headers.size(), frame.size() - headers.size()));
+        store.add(channel, std::move(event));
+    }
+    double addSeconds = secondsSince(start);
+
+    EventStore::Usage usage = store.usage();
+    EventArena::Totals arena = EventArena::totals();
+    std::cout << mode << ": " << usage.events << " events, " << usage.bytes / MiB << " MiB live, RSS +"
+              << (residentBytes() - before) / MiB << " MiB, arena " << arena.mappedBytes / MiB << " MiB mapped, add "
+              << addSeconds << " s";
+
+    start = std::chrono::steady_clock::now();
+    store.dropChannel(channel);
+    std::cout << ", drop " << secondsSince(start) * 1000 << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Writes a synthetic events file for parseEventsFile: the JSON layout of data/events1.json
+// (one event per line inside "events"), or NDJSON (a {"channel_name": ...} line, then one
+// event object per line) for a .ndjson / .jsonl path, the extension parseEventsFile reads
+// the format from. The same seed always gives the same file. Descriptions are cut from a
+// pregenerated block of words and events are formatted straight into a large buffer, so
+// output runs at disk speed.
+// Usage: EventGenerator {file} [--count n] [--channel name] [--seed s]
+//        [--description fixed|uniform|exponential:{mean bytes}] [--cities n] [--users n]
+//        [--start epoch] [--spread seconds]
+// --users 0 (default) writes no "user" field; otherwise each event names one of n users.
+
+namespace {
+
+const char *EVENT_NAMES[] = {"Fire", "Grand Theft Auto", "Vandalism", "Burglary", "Car Accident", "Flood",
+                             "Gas Leak", "Medical Emergency", "Power Outage", "Suspicious Package"};
+const char *WORDS[] = {"smoke", "seen", "near", "block", "units", "on", "the", "way", "white", "van", "two",
+                       "suspects", "heading", "north", "caller", "reports", "injured", "driver", "road", "closed"};
+const std::size_t MAX_DESCRIPTION = 1 << 20;
+
+struct Options {
+    std::string path;
+    unsigned long long count;
+    std::string channel;
+    bool ndjson;
+    unsigned long long seed;
+    std::string distribution; // fixed, uniform or exponential
+    double descriptionMean;
+    std::size_t cities;
+    std::size_t users;
+    long long start;
+    long long spread;
+};
+
+bool endsWith(const std::string &text, const std::string &suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool parseOptions(int argc, char *argv[], Options &options) {
+    if (argc < 2) return false;
+    options.path = argv[1];
+    options.ndjson = endsWith(options.path, ".ndjson") || endsWith(options.path, ".jsonl");
+    try {
+        for (int i = 2; i + 1 < argc; i += 2) {
+            std::string flag = argv[i], value = argv[i + 1];
+            if (flag == "--count") options.count = std::stoull(value);
+            else if (flag == "--channel") options.channel = value;
+            else if (flag == "--seed") options.seed = std::stoull(value);
+            else if (flag == "--cities") options.cities = std::stoul(value);
+            else if (flag == "--users") options.users = std::stoul(value);
+            else if (flag == "--start") options.start = std::stoll(value);
+            else if (flag == "--spread") options.spread = std::stoll(value);
+            else if (flag == "--description") {
+                std::size_t colon = value.find(':');
+                options.distribution = value.substr(0, colon);
+                if (colon != std::string::npos) options.descriptionMean = std::stod(value.substr(colon + 1));
+                if (options.distribution != "fixed" && options.distribution != "uniform" &&
+                    options.distribution != "exponential") return false;
+            } else return false;
+        }
+    } catch (const std::exception &) {
+        return false;
+    }
+    return (argc % 2 == 0) && options.cities > 0 && options.spread > 0 && options.descriptionMean >= 0;
+}
+
+// Text the descriptions are cut from: random words, twice MAX_DESCRIPTION long.
+std::string wordBlock(std::mt19937_64 &random) {
+    std::string block;
+    block.reserve(2 * MAX_DESCRIPTION + 32);
+    while (block.size() < 2 * MAX_DESCRIPTION) {
+        block += WORDS[random() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+        block += random() % 8 == 0 ? ". " : " ";
+    }
+    return block;
+}
+
+void appendNumber(std::string &out, unsigned long long value) {
+    char digits[24];
+    int length = std::snprintf(digits, sizeof(digits), "%llu", value);
+    out.append(digits, length);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options = {"", 1000, "police", false, 1, "exponential", 200, 50, 0, 1700000000, 30 * 86400};
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: EventGenerator {file} [--count n] [--channel name] [--seed s] "
+                     "[--description fixed|uniform|exponential:{mean bytes}] [--cities n] [--users n] "
+                     "[--start epoch] [--spread seconds]" << std::endl;
+        return 1;
+    }
+    std::FILE *file = std::fopen(options.path.c_str(), "wb");
+    if (file == nullptr) {
+        std::cerr << "Could not open " << options.path << std::endl;
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    std::mt19937_64 random(options.seed);
+    std::string block = wordBlock(random);
+    std::exponential_distribution<double> exponential(options.descriptionMean > 0 ? 1 / options.descriptionMean : 1);
+    std::uniform_real_distribution<double> uniform(0, 2 * options.descriptionMean);
+
+    std::string out;
+    out.reserve(8 << 20);
+    out += options.ndjson ? "{\"channel_name\": \"" + options.channel + "\"}\n"
+                          : "{\n    \"channel_name\": \"" + options.channel + "\",\n    \"events\": [\n";
+    unsigned long long bytes = 0;
+    for (unsigned long long i = 0; i < options.count; i++) {
+        double length = options.distribution == "fixed" ? options.descriptionMean
+                        : options.distribution == "uniform" ? uniform(random) : exponential(random);
+        std::size_t descriptionLength = std::min<std::size_t>(static_cast<std::size_t>(length), MAX_DESCRIPTION);
+        std::size_t offset = random() % (block.size() - descriptionLength + 1);
+        std::uint64_t flags = random();
+
+        out += options.ndjson ? "{" : "        {";
+        out += "\"event_name\": \"";
+        out += EVENT_NAMES[random() % (sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]))];
+        out += "\", \"city\": \"City ";
+        appendNumber(out, random() % options.cities);
+        out += "\", \"date_time\": ";
+        appendNumber(out, options.start + static_cast<long long>(random() % options.spread));
+        if (options.users > 0) {
+            out += ", \"user\": \"user_";
+            appendNumber(out, random() % options.users);
+            out += "\"";
+        }
+        out += ", \"description\": \"";
+        out.append(block, offset, descriptionLength);
+        out += "\", \"general_information\": {\"active\": ";
+        out += flags & 1 ? "true" : "false";
+        out += ", \"forces_arrival_at_scene\": ";
+        out += flags & 2 ? "true" : "false";
+        out += "}}";
+        out += options.ndjson || i + 1 == options.count ? "\n" : ",\n";
+
+        if (out.size() >= (8 << 20) - MAX_DESCRIPTION - 512) {
+            bytes += std::fwrite(out.data(), 1, out.size(), file);
+            out.clear();
+        }
+    }
+    if (!options.ndjson) {
+        out += "    ]\n}\n";
+    }
+    bytes += std::fwrite(out.data(), 1, out.size(), file);
+    bool failed = std::ferror(file) != 0;
+    if (std::fclose(file) != 0 || failed) {
+        std::cerr << "Could not write " << options.path << std::endl;
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << options.count << " events, " << bytes << " bytes written to " << options.path << " in " << seconds
+              << " s (" << bytes / 1e6 / seconds << " MB/s)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include "../include/EventLog.h"
+#include "../include/EventStore.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Appends events to an on-disk log, then replays it into a fresh store.
+// Usage: EventLogBench [count] [directory]
+
+static const char *CITIES[] = {"Liberty City", "Vice City", "Raccoon City", "Los Alamos", "San Andreas North District"};
+static const char *NAMES[] = {"Grand Theft Auto", "Vandalism", "Burglary", "Hit and Run", "Structure Fire In Progress"};
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    std::string directory = argc > 2 ? argv[2] : "/tmp/EventLogBench";
+    std::system(("rm -rf '" + directory + "'").c_str());
+
+    InternId channel = StringInterner::instance().intern("police");
+    std::string description(90, 'd');
+    {
+        EventLog log(directory);
+        if (!log.open()) return 1;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < count; i++) {
+            GeneralInformation info;
+            info.set(StringRef("active"), StringRef(i % 2 ? "true" : "false"));
+            info.set(StringRef("forces_arrival_at_scene"), StringRef("true"));
+            Event event("police", CITIES[i % 5], NAMES[i % 5], static_cast<int>(i), description, info);
+            event.setEventOwnerUser("dispatcher_" + std::to_string(i % 1000));
+            log.append(channel, event);
+        }
+        log.flush();
+        double seconds = secondsSince(start);
+        EventLog::Status status = log.status();
+        std::cout << "append: " << count << " events, " << status.diskBytes << " bytes, " << status.commits
+                  << " commits in " << seconds << " s (" << static_cast<long long>(count / seconds) << " events/s)"
+                  << std::endl;
+    }
+
+    EventStore store;
+    EventLog log(directory);
+    EventLog::ReplayResult replayed = log.replay(store);
+    std::cout << "replay: " << replayed.events << " events from " << replayed.segments << " segments in "
+              << replayed.seconds << " s (" << static_cast<long long>(replayed.events / replayed.seconds)
+              << " events/s)" << std::endl;
+    return replayed.events == count ? 0 : 1;
+}
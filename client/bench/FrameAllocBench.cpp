@@ -0,0 +1,83 @@
+#include "../include/StompProtocol.h"
+#include "../include/FrameArena.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// Counts heap allocations per received MESSAGE frame through StompProtocol::parseFrame
+// (header parsing, Event parsing, storing), with each frame copied to its own heap buffer
+// as before and with frames copied into a FrameArena.
+// Linked with -Wl,--wrap=malloc so FrameBuffer's malloc calls are counted too.
+// Usage: FrameAllocBench [count]
+
+static std::size_t allocations = 0;
+
+extern "C" void *__real_malloc(std::size_t size);
+
+extern "C" void *__wrap_malloc(std::size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *operator new(std::size_t size) {
+    allocations++;
+    void *pointer = __real_malloc(size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+static std::vector<std::string> makeFrames(std::size_t count) {
+    static const char *CITIES[] = {"Liberty City", "Vice City", "Raccoon City", "Los Alamos"};
+    std::vector<std::string> frames;
+    for (std::size_t i = 0; i < count; i++) {
+        frames.push_back("MESSAGE\nsubscription:78\nmessage-id:" + std::to_string(i) + "\ndestination:police\n\n"
+                         "user:dispatcher_" + std::to_string(i % 50) + "\ncity:" + CITIES[i % 4] + "\nevent name:Fire\n"
+                         "date time:" + std::to_string(1700000000 + i) + "\ngeneral information:\n active:true\n"
+                         " forces_arrival_at_scene:false\ndescription:\nsmoke seen near block " + std::to_string(i % 100) + "\n");
+    }
+    return frames;
+}
+
+static void run(const char *label, bool useArena, const std::vector<std::string> &frames) {
+    ConnectionHandler handler("127.0.0.1", 7777); // Never connected, parseFrame does not send
+    StompProtocol protocol(handler);
+    FrameArena arena;
+    std::size_t warmup = frames.size() / 2; // Lets the store's vectors and maps reach steady growth
+
+    std::size_t before = 0;
+    std::chrono::steady_clock::time_point start;
+    FrameRef frame;
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        if (i == warmup) {
+            before = allocations;
+            start = std::chrono::steady_clock::now();
+        }
+        frame = FrameRef(); // As ConnectionHandler::getFrame does before reading the next frame
+        const std::string &bytes = frames[i];
+        frame = useArena ? arena.copy(bytes.data(), bytes.size()) : FrameRef(FrameBuffer::create(bytes.data(), bytes.size()));
+        protocol.parseFrame(frame);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::size_t measured = frames.size() - warmup;
+    std::cout << label << ": " << static_cast<double>(allocations - before) / measured << " allocations/frame, "
+              << seconds * 1e9 / measured << " ns/frame" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::vector<std::string> frames = makeFrames(count);
+    run("heap frames ", false, frames);
+    run("frame arena ", true, frames);
+    return 0;
+}
@@ -0,0 +1,192 @@
+#include "BenchHarness.h"
+#include "../include/StompProtocol.h"
+#include "../include/DateFormatter.h"
+#include "../include/event.h"
+#include <climits>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+// Microbenchmarks of the client's hot paths on synthetic inputs of several sizes: parseFrame
+// (store included), Event parsing of a frame body, parseEventsFile, the framing done by
+// StompProtocol::send, summarizeEmergencyChannel (cached and re-rendered) and epochToDate.
+// Usage: HotPathBench [--repetitions n] [--min-time ms] [--warmup ms] [--threshold %]
+//                     [--filter text] [--json file] [--baseline file]
+// Run by "make bench"; a results JSON kept from an earlier run serves as the baseline.
+
+namespace {
+
+volatile std::size_t sink = 0; // Keeps results the compiler could otherwise discard
+
+const char *CITIES[] = {"Liberty City", "Vice City", "Raccoon City", "Los Alamos"};
+const std::size_t DESCRIPTION_SIZES[] = {32, 1024, 16384};
+
+std::string sizeLabel(std::size_t bytes) {
+    return bytes >= 1024 ? std::to_string(bytes / 1024) + "KB" : std::to_string(bytes) + "B";
+}
+
+std::string description(std::size_t length, std::size_t seed) {
+    std::string text;
+    while (text.size() < length) {
+        text += "smoke seen near block " + std::to_string((seed + text.size()) % 997) + ", units on the way. ";
+    }
+    text.resize(length);
+    return text;
+}
+
+std::string eventBody(std::size_t i, std::size_t descriptionLength) {
+    return "user:dispatcher_" + std::to_string(i % 50) + "\ncity:" + CITIES[i % 4] + "\nevent name:Fire\n"
+           "date time:" + std::to_string(1700000000 + i * 60) + "\ngeneral information:\n active:true\n"
+           " forces_arrival_at_scene:false\ndescription:\n" + description(descriptionLength, i) + "\n";
+}
+
+std::string messageFrame(std::size_t i, std::size_t descriptionLength) {
+    return "MESSAGE\nsubscription:78\nmessage-id:" + std::to_string(i) + "\ndestination:police\n\n" +
+           eventBody(i, descriptionLength);
+}
+
+// Writes a parseEventsFile input of count events, returns its size.
+std::size_t writeEventsFile(const std::string &path, std::size_t count) {
+    std::ofstream out(path.c_str());
+    out << "{\n  \"channel_name\": \"police\",\n  \"events\": [\n";
+    for (std::size_t i = 0; i < count; i++) {
+        out << "    {\"event_name\": \"Fire\", \"city\": \"" << CITIES[i % 4] << "\", \"date_time\": "
+            << 1700000000 + i * 60 << ", \"description\": \"" << description(100, i)
+            << "\", \"general_information\": {\"active\": true, \"forces_arrival_at_scene\": false}}"
+            << (i + 1 < count ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return static_cast<std::size_t>(out.tellp());
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    BenchHarness::Options options = {10, 20, 100, 0.10, "", "", ""};
+    std::string error;
+    if (!BenchHarness::parseOptions(argc, argv, options, error)) {
+        std::cerr << error << std::endl;
+        return 1;
+    }
+    BenchHarness harness(options);
+
+    char directoryTemplate[] = "/tmp/HotPathBench-XXXXXX";
+    if (mkdtemp(directoryTemplate) == nullptr) {
+        std::cerr << "Could not create a temporary directory" << std::endl;
+        return 1;
+    }
+    std::string directory = directoryTemplate;
+    std::vector<std::string> files;
+
+    // parseFrame: a stream of MESSAGE frames stored by one protocol, the store kept at a
+    // steady size by a memory budget
+    ConnectionHandler handler("127.0.0.1", 7777); // Never connected, nothing is sent
+    std::vector<std::unique_ptr<StompProtocol>> protocols;
+    for (std::size_t length : DESCRIPTION_SIZES) {
+        std::vector<FrameRef> frames;
+        for (std::size_t i = 0; i < 256; i++) {
+            std::string frame = messageFrame(i, length);
+            frames.push_back(FrameRef(FrameBuffer::create(frame.data(), frame.size())));
+        }
+        protocols.push_back(std::unique_ptr<StompProtocol>(new StompProtocol(handler)));
+        StompProtocol *protocol = protocols.back().get();
+        protocol->setMemoryBudget(8 << 20);
+        harness.add("parseFrame", "desc=" + sizeLabel(length), frames[0]->size(), [protocol, frames](std::size_t n) {
+            for (std::size_t i = 0; i < n; i++) {
+                protocol->parseFrame(frames[i % frames.size()]);
+            }
+        });
+    }
+
+    // Event(frame_body): the body copied into a buffer and parsed
+    for (std::size_t length : DESCRIPTION_SIZES) {
+        std::string body = eventBody(7, length);
+        harness.add("Event(frame_body)", "desc=" + sizeLabel(length), body.size(), [body](std::size_t n) {
+            for (std::size_t i = 0; i < n; i++) {
+                Event event(body);
+                sink += event.get_date_time();
+            }
+        });
+    }
+
+    // parseEventsFile: whole files of 100-byte descriptions
+    for (std::size_t count : {10, 1000, 10000}) {
+        std::string path = directory + "/events" + std::to_string(count) + ".json";
+        files.push_back(path);
+        std::size_t bytes = writeEventsFile(path, count);
+        harness.add("parseEventsFile", std::to_string(count) + " events", bytes, [path](std::size_t n) {
+            for (std::size_t i = 0; i < n; i++) {
+                sink += parseEventsFile(path).events.size();
+            }
+        });
+    }
+
+    // StompProtocol::send framing of a report
+    for (std::size_t length : DESCRIPTION_SIZES) {
+        std::map<std::string, std::string> headers = {{"destination", "police"}};
+        std::string body = eventBody(7, length);
+        harness.add("send framing", "desc=" + sizeLabel(length), body.size(), [headers, body](std::size_t n) {
+            for (std::size_t i = 0; i < n; i++) {
+                sink += StompProtocol::formatFrame("SEND", headers, body).size();
+            }
+        });
+    }
+
+    // summarizeEmergencyChannel over one user's events: the cached full history, and a
+    // date window that is sorted and rendered on every call
+    for (std::size_t count : {100, 10000}) {
+        protocols.push_back(std::unique_ptr<StompProtocol>(new StompProtocol(handler)));
+        StompProtocol *protocol = protocols.back().get();
+        std::streambuf *console = std::cout.rdbuf(nullptr);
+        for (std::size_t i = 0; i < count; i++) {
+            protocol->parseFrame(messageFrame(i * 50, 100)); // Every event by dispatcher_0
+        }
+        std::cout.rdbuf(console);
+        std::cout.clear();
+        std::string path = directory + "/summary" + std::to_string(count) + ".txt";
+        files.push_back(path);
+        std::string input = std::to_string(count) + " events";
+        harness.add("summarize cached", input, 0, [protocol, path](std::size_t n) {
+            for (std::size_t i = 0; i < n; i++) {
+                protocol->summarizeEmergencyChannel("police", "dispatcher_0", path);
+            }
+        });
+        harness.add("summarize window", input, 0, [protocol, path](std::size_t n) {
+            for (std::size_t i = 0; i < n; i++) {
+                protocol->summarizeEmergencyChannel("police", "dispatcher_0", path, 0, LLONG_MAX);
+            }
+        });
+    }
+
+    // epochToDate: consecutive minutes, as in a sorted summary, and random times over 10 years
+    std::vector<int> sequential, scattered;
+    std::mt19937 random(42);
+    for (std::size_t i = 0; i < 4096; i++) {
+        sequential.push_back(1700000000 + static_cast<int>(i) * 60);
+        scattered.push_back(1400000000 + static_cast<int>(random() % (10 * 365 * 86400)));
+    }
+    StompProtocol *formatter = protocols.front().get();
+    harness.add("epochToDate", "sequential", 0, [formatter, sequential](std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) {
+            sink += formatter->epochToDate(sequential[i % sequential.size()]).size();
+        }
+    });
+    harness.add("epochToDate", "random", 0, [formatter, scattered](std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) {
+            sink += formatter->epochToDate(scattered[i % scattered.size()]).size();
+        }
+    });
+
+    int status = harness.run();
+    protocols.clear();
+    for (const std::string &file : files) {
+        std::remove(file.c_str());
+    }
+    rmdir(directory.c_str());
+    return status;
+}
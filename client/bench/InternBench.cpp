@@ -0,0 +1,81 @@
+#include "../include/event.h"
+#include "../include/StringInterner.h"
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+// Measures heap usage of 1M stored events with and without interned names.
+// Usage: InternBench [count]
+
+static std::size_t liveBytes = 0; // Bytes currently allocated through operator new
+
+void *operator new(std::size_t size) {
+    std::size_t *block = static_cast<std::size_t *>(std::malloc(size + sizeof(std::size_t)));
+    if (block == nullptr) throw std::bad_alloc();
+    block[0] = size;
+    liveBytes += size;
+    return block + 1;
+}
+
+void operator delete(void *pointer) noexcept {
+    if (pointer == nullptr) return;
+    std::size_t *block = static_cast<std::size_t *>(pointer) - 1;
+    liveBytes -= block[0];
+    std::free(block);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    operator delete(pointer);
+}
+
+// Field layout of Event before interning.
+struct LegacyEvent {
+    std::string channel_name;
+    std::string city;
+    std::string name;
+    int date_time;
+    std::string description;
+    std::map<std::string, std::string> general_information;
+    std::string eventOwnerUser;
+};
+
+static const char *CITIES[] = {"Liberty City", "Vice City", "Raccoon City", "Los Alamos", "San Andreas North District"};
+static const char *NAMES[] = {"Grand Theft Auto", "Vandalism", "Burglary", "Hit and Run", "Structure Fire In Progress"};
+
+int main(int argc, char *argv[]) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    std::string description(90, 'd');
+    std::map<std::string, std::string> info = {{"active", "true"}, {"forces_arrival_at_scene", "false"}};
+
+    std::size_t before = liveBytes;
+    std::vector<LegacyEvent> legacy;
+    legacy.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        LegacyEvent event = {"police", CITIES[i % 5], NAMES[i % 5], static_cast<int>(i), description, info,
+                             "dispatcher_" + std::to_string(i % 1000)};
+        legacy.push_back(event);
+    }
+    std::size_t legacyBytes = liveBytes - before;
+    std::vector<LegacyEvent>().swap(legacy);
+
+    before = liveBytes;
+    std::vector<Event> interned;
+    interned.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        interned.push_back(Event("police", CITIES[i % 5], NAMES[i % 5], static_cast<int>(i), description, info));
+        interned.back().setEventOwnerUser("dispatcher_" + std::to_string(i % 1000));
+    }
+    std::size_t internedBytes = liveBytes - before;
+
+    std::cout << "events:              " << count << std::endl;
+    std::cout << "sizeof legacy/Event: " << sizeof(LegacyEvent) << " / " << sizeof(Event) << " bytes" << std::endl;
+    std::cout << "legacy heap:         " << legacyBytes / (1024 * 1024) << " MiB" << std::endl;
+    std::cout << "Event heap:          " << internedBytes / (1024 * 1024) << " MiB (table "
+              << StringInterner::instance().memoryUsage() / 1024 << " KiB, "
+              << StringInterner::instance().size() << " strings)" << std::endl;
+    std::cout << "saved:               " << (legacyBytes - internedBytes) / (1024 * 1024) << " MiB ("
+              << (legacyBytes - internedBytes) / count << " bytes/event)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,337 @@
+#include "../include/ConnectionHandler.h"
+#include "../include/StompProtocol.h"
+#include "../include/event.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+
+// Load generator for a running STOMP server (tpc or reactor mode): N publisher and M
+// subscriber connections, each a ConnectionHandler + StompProtocol as in the client, read by
+// a shared pool of I/O threads. Subscriber j joins channel j % C and publisher i sends events,
+// in the report body format, to channel i % C (it joins it too, as the server only accepts
+// SEND from subscribers). Each SEND carries its send time in the timestamp header, which the
+// server forwards on every MESSAGE, so a subscriber measures publish -> delivery latency when
+// the MESSAGE is read. Reports publish throughput, delivered / expected fan-out and latency
+// percentiles.
+// Usage: stompbench {host:port} [--publishers n] [--subscribers m] [--channels c]
+//        [--rate msgs/s] [--duration seconds] [--io-threads t] [--events file]
+//        [--memory-budget bytes]
+// --rate is the total over all publishers, 0 sends as fast as the connections allow.
+// --memory-budget bounds the events each client stores (default 1 MiB, 0 = unlimited), as
+// every client, publishers included, keeps what it receives for the whole run.
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Client {
+    std::string username;
+    std::string channel;
+    bool subscriber;
+    std::unique_ptr<ConnectionHandler> connection;
+    std::unique_ptr<StompProtocol> protocol;
+    std::vector<long long> latencies; // Microseconds; written by the I/O thread reading this client
+    std::size_t published;            // Written by the client's publisher thread
+    bool finished;                    // Reading stopped (guarded by the bench mutex)
+
+    Client() : username(), channel(), subscriber(false), connection(), protocol(), latencies(), published(0), finished(false) {}
+};
+
+struct Options {
+    std::string host;
+    short port;
+    std::size_t publishers;
+    std::size_t subscribers;
+    std::size_t channels;
+    double rate;
+    double duration;
+    std::size_t ioThreads;
+    std::string eventsPath;
+    std::size_t memoryBudget; // Bytes of stored events per client, 0 = unlimited
+};
+
+std::mutex mutex;
+std::condition_variable stopped; // A client finished reading
+std::atomic<std::size_t> delivered(0);
+
+// Latency in microseconds of a MESSAGE with a timestamp header, -1 for other frames.
+long long messageLatency(const FrameRef &frame, long long receivedAt) {
+    static const char KEY[] = "\ntimestamp:";
+    const char *begin = frame->data();
+    const char *end = begin + frame->size();
+    while (begin < end && *begin == '\n') begin++; // Heart-beat newlines between frames
+    if (end - begin < 7 || std::memcmp(begin, "MESSAGE", 7) != 0) return -1;
+    static const char BLANK[] = "\n\n";
+    const char *headersEnd = std::search(begin, end, BLANK, BLANK + 2); // Only the headers are searched
+    const char *found = std::search(begin, headersEnd, KEY, KEY + sizeof(KEY) - 1);
+    if (found == headersEnd) return -1;
+    long long sentAt = 0;
+    for (const char *digit = found + sizeof(KEY) - 1; digit < headersEnd && *digit >= '0' && *digit <= '9'; digit++) {
+        sentAt = sentAt * 10 + (*digit - '0');
+    }
+    return std::max(receivedAt - sentAt, 0LL) / 1000;
+}
+
+bool open(Client &client, const Options &options, boost::asio::io_service &service) {
+    client.connection.reset(new ConnectionHandler(options.host, options.port, service));
+    client.protocol.reset(new StompProtocol(*client.connection)); // Frames are parsed on the I/O thread
+    client.protocol->setMemoryBudget(options.memoryBudget);
+    if (!client.connection->connect()) {
+        client.finished = true; // Nothing to read
+        return false;
+    }
+    Client *reading = &client;
+    client.connection->readFramesAsync(
+        [reading](const FrameRef &frame) {
+            if (reading->subscriber) {
+                long long latency = messageLatency(frame, LatencyHistogram::now());
+                if (latency >= 0) {
+                    reading->latencies.push_back(latency);
+                    delivered.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            reading->protocol->parseFrame(frame); // Stored like any received event
+            return !reading->protocol->shouldStopCommunication();
+        },
+        [reading]() {
+            if (!reading->protocol->shouldStopCommunication()) {
+                std::cerr << "Server connection lost (" << reading->username << ")." << std::endl;
+                reading->protocol->signalStopCommunication();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            reading->finished = true;
+            stopped.notify_all();
+        });
+
+    std::map<std::string, std::string> headers = {
+        {"accept-version", "1.2"}, {"host", "stomp.cs.bgu.ac.il"}, {"login", client.username}, {"passcode", "bench"}};
+    client.protocol->send("CONNECT", headers, "");
+    return true;
+}
+
+void join(Client &client) {
+    int receiptId = client.protocol->getNextReceiptId();
+    int subscriptionId = client.protocol->getNextId();
+    client.protocol->storeSubscriptionId(client.channel, subscriptionId);
+    client.protocol->storeReceipt(receiptId, "Joined channel " + client.channel);
+    client.protocol->send("SUBSCRIBE", {{"destination", client.channel}, {"id", std::to_string(subscriptionId)},
+                                        {"receipt", std::to_string(receiptId)}}, "");
+}
+
+// Sends events round-robin from bodies until the deadline, at rate per second (0 = unpaced).
+void publish(Client &client, const std::vector<std::string> &bodies, double rate, Clock::time_point start,
+             Clock::time_point deadline) {
+    std::map<std::string, std::string> headers = {{"destination", client.channel}};
+    for (std::size_t k = 0; !client.protocol->shouldStopCommunication(); k++) {
+        if (rate > 0) {
+            Clock::time_point due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(k / rate));
+            if (due >= deadline) break;
+            std::this_thread::sleep_until(due);
+        } else if (Clock::now() >= deadline) {
+            break;
+        }
+        headers["timestamp"] = std::to_string(LatencyHistogram::now()); // Nanoseconds, as the report command sends
+        client.protocol->send("SEND", headers, bodies[k % bodies.size()]);
+        client.published++;
+    }
+}
+
+// Waits until every client is logged in and acknowledged its requests.
+bool waitAll(std::vector<std::unique_ptr<Client>> &clients, long long timeoutMs) {
+    for (std::unique_ptr<Client> &client : clients) {
+        if (!client->protocol->waitForReceipts(timeoutMs)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseOptions(int argc, char *argv[], Options &options) {
+    if (argc < 2) return false;
+    std::string hostPort = argv[1];
+    std::size_t colon = hostPort.find(':');
+    if (colon == std::string::npos) return false;
+    options.host = hostPort.substr(0, colon);
+    options.port = std::stoi(hostPort.substr(colon + 1));
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string flag = argv[i], value = argv[i + 1];
+        if (flag == "--publishers") options.publishers = std::stoul(value);
+        else if (flag == "--subscribers") options.subscribers = std::stoul(value);
+        else if (flag == "--channels") options.channels = std::stoul(value);
+        else if (flag == "--rate") options.rate = std::stod(value);
+        else if (flag == "--duration") options.duration = std::stod(value);
+        else if (flag == "--io-threads") options.ioThreads = std::stoul(value);
+        else if (flag == "--events") options.eventsPath = value;
+        else if (flag == "--memory-budget") options.memoryBudget = std::stoull(value);
+        else return false;
+    }
+    return options.publishers > 0 && options.channels > 0 && options.ioThreads > 0;
+}
+
+long long percentile(const std::vector<long long> &sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    std::size_t rank = static_cast<std::size_t>(fraction * sorted.size());
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options = {"", 0, 4, 16, 4, 1000, 10, std::min(4u, std::max(1u, std::thread::hardware_concurrency())), "", 1 << 20};
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: stompbench {host:port} [--publishers n] [--subscribers m] [--channels c] [--rate msgs/s] "
+                     "[--duration seconds] [--io-threads t] [--events file] [--memory-budget bytes]" << std::endl;
+        return 1;
+    }
+
+    // Event templates: the events of a file, or one fixed event
+    std::vector<Event> events;
+    if (!options.eventsPath.empty()) {
+        events = parseEventsFile(options.eventsPath).events;
+    }
+    if (events.empty()) {
+        events.push_back(Event("", "Liberty City", "Grand Theft Auto", 1734961200,
+                               "Pink Lampadati Felon with license plate \"STOL3N1\".",
+                               GeneralInformation({{"active", "true"}, {"forces_arrival_at_scene", "false"}})));
+    }
+
+    boost::asio::io_service service;
+    std::unique_ptr<boost::asio::io_service::work> work(new boost::asio::io_service::work(service));
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < options.ioThreads; i++) {
+        threads.push_back(std::thread([&service]() { service.run(); }));
+    }
+
+    // Publishers first, then subscribers; each one logs in under its own name
+    std::vector<std::unique_ptr<Client>> clients;
+    std::vector<std::size_t> fanOut(options.channels, 0); // Subscribers per channel
+    for (std::size_t i = 0; i < options.publishers + options.subscribers; i++) {
+        std::unique_ptr<Client> client(new Client());
+        bool subscriber = i >= options.publishers;
+        std::size_t index = subscriber ? i - options.publishers : i;
+        client->username = (subscriber ? "bench-sub-" : "bench-pub-") + std::to_string(index);
+        client->channel = "bench-" + std::to_string(index % options.channels);
+        client->subscriber = subscriber;
+        if (subscriber) fanOut[index % options.channels]++;
+        clients.push_back(std::move(client));
+    }
+
+    // The protocol prints every login and receipt; only the report goes to the console
+    std::streambuf *console = std::cout.rdbuf(nullptr);
+    bool ready = true;
+    for (std::unique_ptr<Client> &client : clients) {
+        if (!open(*client, options, service)) {
+            ready = false;
+            break;
+        }
+    }
+    ready = ready && waitAll(clients, 10000);
+    if (ready) {
+        for (std::unique_ptr<Client> &client : clients) {
+            join(*client);
+        }
+        ready = waitAll(clients, 10000);
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point publishEnd = start, drainEnd = start;
+    std::size_t expected = 0;
+    if (ready) {
+        Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+        std::vector<std::thread> publishers;
+        for (std::size_t i = 0; i < options.publishers; i++) {
+            std::vector<std::string> bodies;
+            for (const Event &event : events) {
+                // Events of a generated file may name their user, for summaries across many users
+                const std::string &owner = event.getEventOwnerUser();
+                bodies.push_back(formatEventBody(owner.empty() ? clients[i]->username : owner, event));
+            }
+            publishers.push_back(std::thread(publish, std::ref(*clients[i]), bodies, options.rate / options.publishers,
+                                             start, deadline));
+        }
+        for (std::thread &publisher : publishers) {
+            publisher.join();
+        }
+        publishEnd = Clock::now();
+
+        // Wait up to 5 seconds for the deliveries still in flight
+        for (std::size_t i = 0; i < options.publishers; i++) {
+            expected += clients[i]->published * fanOut[i % options.channels];
+        }
+        Clock::time_point drainDeadline = publishEnd + std::chrono::seconds(5);
+        while (delivered.load(std::memory_order_relaxed) < expected && Clock::now() < drainDeadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        drainEnd = Clock::now();
+    }
+
+    // Log out, then wait for the server to end every connection
+    for (std::unique_ptr<Client> &client : clients) {
+        if (!client->protocol || !client->protocol->isConnected() || client->protocol->shouldStopCommunication()) continue;
+        int receiptId = client->protocol->getNextReceiptId();
+        client->protocol->storeReceipt(receiptId, "Logout");
+        client->protocol->send("DISCONNECT", {{"receipt", std::to_string(receiptId)}}, "");
+    }
+    bool errors = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (std::unique_ptr<Client> &client : clients) {
+            if (!client->protocol) continue; // Not opened
+            errors = errors || client->protocol->hasErrorOccurred();
+            Client &waited = *client;
+            if (!stopped.wait_for(lock, std::chrono::seconds(5), [&waited]() { return waited.finished; })) {
+                waited.protocol->signalStopCommunication();
+                waited.connection->shutdown();
+                stopped.wait(lock, [&waited]() { return waited.finished; });
+            }
+        }
+    }
+    work.reset();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    for (std::unique_ptr<Client> &client : clients) {
+        if (client->connection) client->connection->close();
+    }
+    std::cout.rdbuf(console);
+
+    if (!ready || errors) {
+        std::cerr << "stompbench: " << (ready ? "the server sent an ERROR" : "could not connect, log in and join every client")
+                  << std::endl;
+        return 1;
+    }
+
+    std::size_t published = 0;
+    std::vector<long long> latencies;
+    for (std::unique_ptr<Client> &client : clients) {
+        published += client->published;
+        latencies.insert(latencies.end(), client->latencies.begin(), client->latencies.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double publishSeconds = std::chrono::duration<double>(publishEnd - start).count();
+    double deliverySeconds = std::chrono::duration<double>(drainEnd - start).count();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "connections : " << options.publishers << " publishers, " << options.subscribers << " subscribers, "
+              << options.channels << " channels, " << options.ioThreads << " I/O threads" << std::endl;
+    std::cout << "published   : " << published << " in " << publishSeconds << " s, " << published / publishSeconds
+              << " msgs/s (target " << (options.rate > 0 ? std::to_string(static_cast<long long>(options.rate)) : "max")
+              << ")" << std::endl;
+    std::cout << "delivered   : " << latencies.size() << " of " << expected << " expected ("
+              << (expected ? 100.0 * latencies.size() / expected : 100.0) << "%), " << latencies.size() / deliverySeconds
+              << " msgs/s" << std::endl;
+    std::cout << "latency us  : p50 " << percentile(latencies, 0.5) << ", p90 " << percentile(latencies, 0.9)
+              << ", p99 " << percentile(latencies, 0.99) << ", p99.9 " << percentile(latencies, 0.999)
+              << ", max " << (latencies.empty() ? 0 : latencies.back()) << std::endl;
+    return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Command script for batch mode: one client command per line, read instead of the keyboard.
+// Blank lines and lines starting with '#' are skipped. "repeat {n}" ... "end" blocks run their
+// lines n times and may be nested; they are unrolled while iterating, so a large count costs
+// no memory. Other directives ("sleep", "wait-receipt") are ordinary commands of the client.
+class CommandScript
+{
+public:
+    struct Command {
+        std::size_t line; // 1-based line in the script file
+        std::string text;
+    };
+
+    CommandScript();
+
+    bool load(const std::string &path, std::string &error); // False if unreadable or unbalanced
+    bool next(Command &command);                            // False once the script is done
+
+private:
+    enum Kind { COMMAND, REPEAT, END };
+
+    struct Entry {
+        Kind kind;
+        std::size_t line;
+        std::string text;
+        unsigned long long count; // REPEAT: iterations
+        std::size_t match;        // REPEAT: index of its END, END: index of its REPEAT
+    };
+
+    struct Loop {
+        std::size_t begin; // Index of the REPEAT entry
+        unsigned long long remaining;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<Loop> loops; // Repeat blocks being run, innermost last
+    std::size_t position;
+};
@@ -2,7 +2,12 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
+#include <memory>
+#include <functional>
 #include <boost/asio.hpp>
+#include "FrameBuffer.h"
+#include "FrameArena.h"
 
 using boost::asio::ip::tcp;
 
@@ -10,12 +15,39 @@ class ConnectionHandler {
 private:
 	const std::string host_;
 	const short port_;
-	boost::asio::io_service io_service_;   // Provides core I/O functionality
+	std::unique_ptr<boost::asio::io_service> ownedService_; // Null when the io_service is shared
+	boost::asio::io_service &io_service_;   // Provides core I/O functionality
 	tcp::socket socket_;
+	std::vector<char> readBuffer_; // Bytes received but not yet consumed
+	size_t readBegin_;             // First unconsumed byte in readBuffer_
+	size_t readEnd_;               // End of received bytes in readBuffer_
+	size_t readScanned_;           // Bytes before this were already searched for a delimiter
+	FrameArena frameArena_;        // Storage of received frames, reused once a frame is released
+	std::function<bool(const FrameRef &)> frameHandler_; // Set by readFramesAsync
+	std::function<void()> endHandler_;
+
+	// Reads whatever is available from the socket into readBuffer_ - blocking.
+	bool fillBuffer();
+
+	// Takes the next complete frame out of the received bytes; false if none is complete yet.
+	bool takeFrame(FrameRef &frame, char delimiter);
+
+	// Moves a partial frame to the front of readBuffer_, growing it only if the frame fills it.
+	void makeRoom();
+
+	// Hands the buffered frames to frameHandler_, then waits for more data on the io_service.
+	void continueAsyncRead();
+
+	ConnectionHandler(const ConnectionHandler &) = delete;
+	ConnectionHandler &operator=(const ConnectionHandler &) = delete;
 
 public:
 	ConnectionHandler(std::string host, short port);
 
+	// Uses a shared io_service (e.g. run by a pool of threads for many connections) and a
+	// small initial read buffer; reads are then done with readFramesAsync.
+	ConnectionHandler(std::string host, short port, boost::asio::io_service &service);
+
 	virtual ~ConnectionHandler();
 
 	// Connect to the remote machine
@@ -41,10 +73,26 @@ public:
 	// Returns false in case connection closed before null can be read.
 	bool getFrameAscii(std::string &frame, char delimiter);
 
+	// Get the next frame up to the delimiter as a single retained buffer (delimiter excluded).
+	// Drops the reference frame held first, so its storage can be reused for the next frame.
+	// Returns false in case connection closed before the delimiter can be read.
+	bool getFrame(FrameRef &frame, char delimiter);
+
+	// Reads frames on the io_service's threads: onFrame(frame) is called for each frame, in order
+	// and never concurrently, as long as it returns true. onEnd() is called once when reading
+	// stopped, because onFrame returned false or the connection was closed.
+	void readFramesAsync(std::function<bool(const FrameRef &)> onFrame, std::function<void()> onEnd);
+
 	// Send a message to the remote host.
 	// Returns false in case connection is closed before all the data is sent.
 	bool sendFrameAscii(const std::string &frame, char delimiter);
 
+	// Frames received and buffer allocations made for them (see FrameArena).
+	FrameArena::Counters frameCounters() const { return frameArena_.counters(); }
+
+	// Stops reading and writing, waking a thread blocked in a read. Safe from any thread.
+	void shutdown();
+
 	// Close down the connection properly.
 	void close();
 
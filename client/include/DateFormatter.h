@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Formats epoch seconds as local "%d/%m/%y %H:%M" without std::localtime or streams.
+// The UTC offset is cached together with the interval it is valid for, and the
+// "dd/mm/yy" prefix is cached per local day, so consecutive dates cost a few integer ops.
+// All caches are thread_local, so the formatter is safe to use from several threads.
+class DateFormatter
+{
+public:
+    static const std::size_t LENGTH = 14; // Length of "dd/mm/yy HH:MM"
+
+    static char *format(int epochTime, char *out); // Writes LENGTH chars to out, returns out + LENGTH
+    static std::string format(int epochTime);      // Convenience wrapper returning a string
+
+private:
+    static long utcOffset(long long time); // Local UTC offset (seconds) at the given time, cached per interval
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include "FrameBuffer.h"
+#include "StringRef.h"
+
+// Bump allocator for the bytes a stored event keeps (its description), one per channel.
+// Bytes are copied into large mmap'ed blocks, optionally backed by transparent huge pages,
+// so a channel's events are densely packed and the received frames they came from go back
+// to malloc right away instead of pinning the heap. Each block is a FrameBuffer adopting its
+// mapping: events reference their block the way they referenced their frame, and the block
+// is unmapped when its last event is evicted or dropped, one munmap per block.
+class EventArena
+{
+public:
+    static const std::size_t BLOCK_BYTES = std::size_t(1) << 20;
+    static const std::size_t HUGE_BLOCK_BYTES = std::size_t(2) << 20; // One huge page, aligned
+
+    struct Totals {
+        std::size_t blocks;      // Blocks still mapped, by all arenas
+        std::size_t mappedBytes;
+    };
+
+    EventArena();
+
+    void setHugePages(bool enabled) { hugePages = enabled; } // Applies to blocks mapped from now on
+
+    // Copies bytes into the arena. Sets block to the block holding the copy.
+    StringRef copy(const StringRef &bytes, FrameRef &block);
+
+    static Totals totals();
+
+private:
+    FrameRef current; // Block being filled, null before the first copy
+    std::size_t used;
+    bool hugePages;
+
+    static FrameRef mapBlock(std::size_t minimum, bool hugePages);
+    static void unmapBlock(char *data, std::size_t length);
+};
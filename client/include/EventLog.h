@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include "event.h"
+#include "EventStore.h"
+
+// Append-only on-disk log of received events, replayed into the store on the next login.
+// Records are appended to numbered segment files ("segment-<n>.log"); a background thread
+// writes the pending records and fsyncs them as one group every few milliseconds. Segments
+// roll at a fixed size, and when the log outgrows its disk limit the sealed segments are
+// compacted: dropped channels and expired events are removed, then the oldest records.
+// Replay maps each segment into memory; stored events keep views into the mapping.
+class EventLog
+{
+public:
+    struct ReplayResult {
+        std::size_t segments;
+        std::size_t events;
+        std::size_t bytes;
+        double seconds;
+    };
+
+    struct Status {
+        std::size_t segments;
+        std::size_t diskBytes;
+        std::uint64_t appended;    // Records appended since open
+        std::uint64_t commits;     // Group commits (fsyncs)
+        std::uint64_t compactions;
+    };
+
+    static const std::size_t DEFAULT_SEGMENT_BYTES = std::size_t(64) << 20;
+    static const std::size_t DEFAULT_MAX_BYTES = std::size_t(1) << 30;
+
+    EventLog(const std::string &directory, std::size_t segmentBytes = DEFAULT_SEGMENT_BYTES,
+             std::size_t maxBytes = DEFAULT_MAX_BYTES);
+    ~EventLog(); // Commits pending records and stops the writer
+
+    bool open();                           // Creates the directory and starts a new segment
+    ReplayResult replay(EventStore &store); // Adds the logged events to store, before open()
+    ReplayResult replay(const EventStoreRouter &storeOf); // Same, each channel into storeOf(channel)
+
+    void append(InternId channel, const Event &event); // Queues an event record
+    void appendDrop(InternId channel);                 // Queues a tombstone for a dropped channel
+    void setTtl(long long seconds);                    // Expiry applied by compaction (0 = off)
+    void flush();                                      // Waits until queued records are durable
+
+    Status status() const;
+    const std::string &getDirectory() const { return directory; }
+
+private:
+    struct Segment {
+        std::uint64_t number;
+        std::size_t bytes;
+    };
+
+    static const std::size_t MAX_PENDING_BYTES = std::size_t(64) << 20; // Appenders wait beyond this
+    static const int COMMIT_INTERVAL_MS = 5;
+
+    std::string directory;
+    std::size_t segmentBytes;
+    std::size_t maxBytes;
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;    // Writer: records pending or stopping
+    std::condition_variable drained; // Appenders and flush(): a group was committed
+    std::string pending;             // Serialized records not yet written
+    std::uint64_t queuedBytes;       // Total bytes ever queued
+    std::uint64_t durableBytes;      // Total bytes written and fsynced
+    bool stopping;
+    long long ttl;
+
+    std::vector<Segment> segments; // Sorted by number; the last one is active once open
+    int fd;                         // Active segment, -1 before open
+    std::thread writer;
+
+    std::uint64_t appended;
+    std::uint64_t commits;
+    std::uint64_t compactions;
+
+    EventLog(const EventLog &) = delete;
+    EventLog &operator=(const EventLog &) = delete;
+
+    std::string segmentPath(std::uint64_t number) const;
+    void scanSegments();
+    bool startSegment(std::uint64_t number);
+    void run();         // Writer thread: group commit, rolling and compaction
+    void roll();        // Seals the active segment and starts the next one
+    void compact();     // Rewrites the sealed segments within the disk limit
+};
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include "event.h"
+#include "TimerWheel.h"
+#include "TextIndex.h"
+#include "Sketches.h"
+#include "Rollup.h"
+#include "EventArena.h"
+
+// Received events per channel, in arrival order, with per-channel byte accounting.
+// Memory is bounded by optional eviction policies:
+//  - budget: when total bytes exceed it, the oldest events of the largest channel go first;
+//  - TTL: events older than the newest date_time seen minus ttl expire (via a timer wheel);
+//  - unsubscribe: a channel's events are dropped when the client exits it.
+// Descriptions of stored events are copied into a per-channel EventArena (unless disabled),
+// so the frames they were received in are freed on arrival.
+// Each channel also has a fixed-size ChannelSketch and a RollupTable of everything it ever
+// received; neither is evicted, so they cover events the policies have already released.
+// Not thread-safe; StompProtocol serializes access.
+class EventStore
+{
+public:
+    struct Usage {
+        std::size_t bytes;               // Bytes held by live events
+        std::size_t events;              // Live events
+        std::size_t budget;              // 0 = unlimited
+        long long ttl;                   // Seconds, 0 = disabled
+        bool freeOnUnsubscribe;
+        std::size_t evictedByBudget;
+        std::size_t evictedByTtl;
+        std::size_t evictedByUnsubscribe;
+    };
+
+    struct ChannelUsage {
+        InternId channel;
+        std::size_t events;
+        std::size_t bytes;
+    };
+
+    // Column arrays of a channel for scans, one row per stored event in arrival order.
+    // Evicted rows stay until trimmed, with live[row] == 0.
+    struct ColumnView {
+        std::size_t rows;
+        const int *dateTime;
+        const InternId *city;
+        const InternId *user;
+        const InternId *name;
+        const std::uint8_t *present; // GeneralInformation flag bits
+        const std::uint8_t *values;
+        const std::uint8_t *live;
+    };
+
+    EventStore();
+
+    void add(InternId channel, Event &&event); // Stores an event, then applies the eviction policies
+
+    // Calls visit(event) for every live event of the channel, in arrival order.
+    template <typename Visitor>
+    void forEach(InternId channel, Visitor visit) const;
+
+    // Calls visit(event) for the live events with from <= date_time <= to, in no particular
+    // order. Served by the channel's time index in O(log n + k).
+    template <typename Visitor>
+    void forEachInRange(InternId channel, long long from, long long to, Visitor visit) const;
+
+    // Calls visit(event) for the live events whose description, name or city contain every
+    // term (see TextIndex::tokenize), in arrival order.
+    template <typename Visitor>
+    void search(InternId channel, const std::vector<std::string> &terms, Visitor visit) const;
+
+    // Calls visit(event) for the live events added at or after sequence number seq (see endSeq),
+    // in arrival order.
+    template <typename Visitor>
+    void forEachSince(InternId channel, std::uint64_t seq, Visitor visit) const;
+
+    // Change tracking for caches of derived results. userVersion counts the events ever added
+    // for (channel, user); removalVersion changes whenever events of the channel are evicted or
+    // the channel is dropped or recreated; endSeq is the sequence number of the next event.
+    std::uint64_t userVersion(InternId channel, InternId user) const;
+    std::uint64_t removalVersion(InternId channel) const;
+    std::uint64_t endSeq(InternId channel) const;
+
+    // Appends the ColumnView rows of the live events with from <= date_time <= to.
+    void rowsInRange(InternId channel, long long from, long long to, std::vector<std::uint32_t> &rows) const;
+
+    bool hasChannel(InternId channel) const;
+    bool columns(InternId channel, ColumnView &view) const; // False if the channel has no events
+    void dropChannel(InternId channel); // Frees all events of a channel (counted as unsubscribe evictions)
+    const ChannelSketch *sketch(InternId channel) const; // Null if the channel never had an event
+    const RollupTable *rollup(InternId channel) const;   // Null if the channel never had an event
+
+    void setBudget(std::size_t bytes);
+    void setTtl(long long seconds);
+    void setFreeOnUnsubscribe(bool enabled);
+    bool freeOnUnsubscribe() const { return freeOnExit; }
+    void setArena(bool enabled, bool hugePages); // Applies to events added from now on
+    bool arenaEnabled() const { return useArena; }
+    bool arenaHugePages() const { return hugePages; }
+    void setRollupWidth(long long seconds); // Rebuilds the rollups from the stored events only
+    long long rollupWidth() const { return bucketWidth; }
+
+    Usage usage() const;
+    std::vector<ChannelUsage> channelUsage() const;
+
+private:
+    struct TimeEntry {
+        int dateTime;
+        std::uint64_t seq; // Sequence number of the event within its channel
+    };
+
+    struct StoredEvent {
+        Event event;
+        std::uint32_t bytes; // Accounted size, 0 once evicted
+        bool live;
+    };
+
+    struct Channel {
+        std::deque<StoredEvent> events; // Arrival order; evicted entries stay as tombstones until trimmed
+        std::uint64_t firstSeq;         // Sequence number of events.front()
+        std::size_t bytes;
+        std::size_t liveCount;
+
+        // Scan columns; events[i] is row columnBase + i. Trimmed rows are erased in batches.
+        std::vector<int> dateTime;
+        std::vector<InternId> city;
+        std::vector<InternId> user;
+        std::vector<InternId> name;
+        std::vector<std::uint8_t> present;
+        std::vector<std::uint8_t> values;
+        std::vector<std::uint8_t> live;
+        std::size_t columnBase;
+
+        // Time index: a run sorted by date_time plus a tail of out-of-order arrivals. The tail
+        // is sorted when a range is looked up and merged into the run once it grows.
+        std::vector<TimeEntry> timeRun;
+        mutable std::vector<TimeEntry> timeTail;
+        mutable bool tailSorted;
+
+        TextIndex text; // Tokens of description, name and city; pruned with the columns
+
+        std::uint64_t lastRemoval; // removalClock at the last eviction or at creation
+
+        EventArena arena; // Descriptions of the channel's events
+
+        Channel() : events(), firstSeq(0), bytes(0), liveCount(0), dateTime(), city(), user(), name(),
+                    present(), values(), live(), columnBase(0), timeRun(), timeTail(), tailSorted(true), text(),
+                    lastRemoval(0), arena() {}
+    };
+
+    // Bytes accounted per event for its columns and time index entry
+    static const std::size_t COLUMN_ROW_BYTES = sizeof(int) + 3 * sizeof(InternId) + 3 + sizeof(TimeEntry);
+    static const std::size_t MIN_TAIL_MERGE = 1024; // The tail merges when larger than this and run / 8
+    static const std::size_t WHEEL_SLOTS = 256;
+    static const long long WHEEL_SLOTS_PER_TTL = 64; // TTL resolution is ttl / 64
+
+    std::unordered_map<InternId, Channel> channels;
+    std::unordered_map<InternId, ChannelSketch> sketches; // Outlive dropChannel
+    std::unordered_map<InternId, RollupTable> rollups;    // Likewise
+    long long bucketWidth;                                // Seconds per rollup bucket
+    TimerWheel wheel;
+    long long watermark; // Newest date_time seen, the clock of the TTL policy
+    bool hasWatermark;
+    std::uint64_t nextChannelSeq; // First sequence number of the next channel created
+    std::uint64_t removalClock;   // Source of Channel::lastRemoval values
+    std::unordered_map<std::uint64_t, std::uint64_t> userVersions; // (channel << 32 | user) -> events added
+
+    std::size_t budget;
+    long long ttl;
+    bool freeOnExit;
+    bool useArena;
+    bool hugePages;
+
+    std::size_t totalBytes;
+    std::size_t totalEvents;
+    std::size_t evictedByBudget;
+    std::size_t evictedByTtl;
+    std::size_t evictedByUnsubscribe;
+
+    void evict(Channel &channel, std::size_t index); // Releases events[index], leaving a tombstone
+    void trimFront(Channel &channel);                // Pops tombstones at the front
+    void enforceBudget();
+    void expire(const TimerWheel::Entry &entry);
+    void rescheduleAll(); // Rebuilds the wheel after a TTL change
+    void addToRollup(InternId channel, const Event &event);
+
+    void indexTime(Channel &channel, int dateTime, std::uint64_t seq);
+    void mergeTail(Channel &channel); // Merges the tail into the run and drops entries of evicted events
+    static bool isLive(const Channel &channel, std::uint64_t seq);
+
+    // Calls visit(index into events) for the live events of a channel in [from, to].
+    template <typename Visitor>
+    static void forEachIndexInRange(const Channel &channel, long long from, long long to, Visitor visit);
+};
+
+// Picks the store of a channel when channels are spread over several stores.
+typedef std::function<EventStore &(InternId channel)> EventStoreRouter;
+
+template <typename Visitor>
+void EventStore::forEachIndexInRange(const Channel &channel, long long from, long long to, Visitor visit) {
+    if (from > to) return;
+    if (!channel.tailSorted) {
+        std::sort(channel.timeTail.begin(), channel.timeTail.end(),
+                  [](const TimeEntry &a, const TimeEntry &b) { return a.dateTime < b.dateTime; });
+        channel.tailSorted = true;
+    }
+    const std::vector<TimeEntry> *sorted[] = {&channel.timeRun, &channel.timeTail};
+    for (const std::vector<TimeEntry> *entries : sorted) {
+        std::vector<TimeEntry>::const_iterator it = std::lower_bound(entries->begin(), entries->end(), from,
+            [](const TimeEntry &entry, long long time) { return entry.dateTime < time; });
+        for (; it != entries->end() && it->dateTime <= to; ++it) {
+            if (isLive(channel, it->seq)) {
+                visit(static_cast<std::size_t>(it->seq - channel.firstSeq));
+            }
+        }
+    }
+}
+
+template <typename Visitor>
+void EventStore::forEachInRange(InternId channel, long long from, long long to, Visitor visit) const {
+    std::unordered_map<InternId, Channel>::const_iterator it = channels.find(channel);
+    if (it == channels.end()) return;
+    const Channel &found = it->second;
+    forEachIndexInRange(found, from, to, [&](std::size_t index) { visit(found.events[index].event); });
+}
+
+template <typename Visitor>
+void EventStore::search(InternId channel, const std::vector<std::string> &terms, Visitor visit) const {
+    std::unordered_map<InternId, Channel>::const_iterator it = channels.find(channel);
+    if (it == channels.end()) return;
+    const Channel &found = it->second;
+    for (std::uint64_t seq : found.text.search(terms)) {
+        if (isLive(found, seq)) {
+            visit(found.events[static_cast<std::size_t>(seq - found.firstSeq)].event);
+        }
+    }
+}
+
+template <typename Visitor>
+void EventStore::forEachSince(InternId channel, std::uint64_t seq, Visitor visit) const {
+    std::unordered_map<InternId, Channel>::const_iterator it = channels.find(channel);
+    if (it == channels.end()) return;
+    const Channel &found = it->second;
+    std::size_t index = seq > found.firstSeq ? static_cast<std::size_t>(seq - found.firstSeq) : 0;
+    for (; index < found.events.size(); index++) {
+        if (found.events[index].live) {
+            visit(found.events[index].event);
+        }
+    }
+}
+
+template <typename Visitor>
+void EventStore::forEach(InternId channel, Visitor visit) const {
+    std::unordered_map<InternId, Channel>::const_iterator it = channels.find(channel);
+    if (it == channels.end()) return;
+    for (const StoredEvent &stored : it->second.events) {
+        if (stored.live) {
+            visit(stored.event);
+        }
+    }
+}
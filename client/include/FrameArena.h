@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include "FrameBuffer.h"
+
+// Reusable storage for received frames. A frame is copied into one of the arena's blocks, with
+// its FrameBuffer header in front of the bytes; once every reference to the frame is gone, a
+// later frame reuses the block, so steady-state parsing allocates nothing (a monotonic arena
+// reset after each frame). A frame released before the next one arrives gives its block
+// straight back; frames queued for workers take the ring's blocks in turn, so up to RING_SIZE
+// frames can be in flight without allocating. A frame still referenced when the ring comes
+// back to its block, e.g. kept by a stored event, takes the block along and the arena starts a
+// new one. copy() is called by one thread; frames may be released from any thread.
+class FrameArena
+{
+public:
+    static const std::size_t BLOCK_ROUNDING = 256; // Blocks fit their frame closely, a detached one is not wasteful
+    static const std::size_t RING_SIZE = 32;       // Blocks kept for frames in flight
+
+    struct Counters {
+        std::size_t frames;
+        std::size_t blocks; // Blocks allocated; frames - blocks were served without allocating
+    };
+
+    FrameArena();
+    ~FrameArena(); // A block still in use is freed with its frame's last reference
+
+    FrameRef copy(const char *data, std::size_t length);
+
+    Counters counters() const { return Counters{frames, blocks}; }
+
+private:
+    enum State { FREE, IN_USE, DETACHED }; // DETACHED: no longer the arena's, freed by its frame
+
+    struct Block {
+        std::atomic<int> state;
+        std::size_t capacity; // Total bytes, including this header
+    };
+
+    static const std::size_t HEADER_OFFSET; // Block layout: [Block][FrameBuffer][bytes, spare byte]
+    static const std::size_t BYTES_OFFSET;
+
+    Block *ring[RING_SIZE];
+    std::size_t current; // Slot of the latest frame
+    std::size_t frames;
+    std::size_t blocks;
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    static void releaseFrame(char *data, std::size_t length);
+    static void freeBlock(Block *block);
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "StringRef.h"
+
+// Reference-counted, immutable copy of one received frame. The header and the bytes
+// share a single allocation, and a '\0' is kept after the last byte. Stored events keep
+// views (offset + length) into the frame they were parsed from instead of copying fields.
+// A buffer can also adopt external storage (e.g. a memory-mapped log segment) that is
+// handed to a release function when the last reference goes away, or be placed with its
+// bytes in memory owned by an allocator such as FrameArena.
+class FrameBuffer
+{
+public:
+    typedef void (*ReleaseFunction)(char *data, std::size_t length);
+
+    static FrameBuffer *allocate(std::size_t length);                // Uninitialized bytes, reference count 1
+    static FrameBuffer *create(const char *data, std::size_t length); // Copy of data, reference count 1
+    static FrameBuffer *adopt(char *data, std::size_t length, ReleaseFunction release); // External bytes, no spare byte
+    // Header constructed at memory, bytes at data (length + 1 bytes); release gets data back
+    static FrameBuffer *place(void *memory, char *data, std::size_t length, ReleaseFunction release);
+
+    const char *data() const { return bytes(); }
+    char *mutableData() { return bytes(); } // Only while the buffer is not yet shared
+    std::size_t size() const { return length; }
+    StringRef view(std::uint32_t offset, std::uint32_t count) const { return StringRef(data() + offset, count); }
+    bool external() const { return release_ != nullptr && !placed; } // Shared storage outside the heap (mappings)
+
+    void retain() { references.fetch_add(1, std::memory_order_relaxed); }
+    void release();
+
+private:
+    std::atomic<std::uint32_t> references;
+    std::size_t length;
+    char *storage;            // Bytes following the header, or external storage
+    ReleaseFunction release_; // Frees external storage, null for inline bytes
+    bool placed;              // Header not allocated by FrameBuffer, release_ reclaims it
+
+    FrameBuffer(std::size_t length, char *storage, ReleaseFunction release, bool placed) :
+        references(1), length(length), storage(storage), release_(release), placed(placed) {}
+    FrameBuffer(const FrameBuffer &) = delete;
+    FrameBuffer &operator=(const FrameBuffer &) = delete;
+
+    char *bytes() const { return storage; }
+};
+
+// Owning handle to a FrameBuffer: copies share the buffer, the last one frees it.
+class FrameRef
+{
+public:
+    FrameRef() : buffer(nullptr) {}
+    explicit FrameRef(FrameBuffer *adopted) : buffer(adopted) {} // Takes over one reference
+    FrameRef(const FrameRef &other) : buffer(other.buffer) { if (buffer) buffer->retain(); }
+    FrameRef(FrameRef &&other) : buffer(other.buffer) { other.buffer = nullptr; }
+    ~FrameRef() { if (buffer) buffer->release(); }
+
+    FrameRef &operator=(FrameRef other) { // Copy-and-swap covers both copy and move
+        FrameBuffer *previous = buffer;
+        buffer = other.buffer;
+        other.buffer = previous;
+        return *this;
+    }
+
+    FrameBuffer *get() const { return buffer; }
+    FrameBuffer *operator->() const { return buffer; }
+    explicit operator bool() const { return buffer != nullptr; }
+
+private:
+    FrameBuffer *buffer;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include "StringRef.h"
+
+// Headers of one parsed frame, kept as views into the frame buffer (no allocation).
+// Like the map it replaces, a repeated key resolves to its last value.
+class FrameHeaders
+{
+public:
+    static const std::size_t MAX_HEADERS = 16; // Extra headers are ignored
+
+    FrameHeaders() : keys(), values(), count(0) {}
+
+    void add(const StringRef &key, const StringRef &value) {
+        if (count < MAX_HEADERS) {
+            keys[count] = key;
+            values[count] = value;
+            count++;
+        }
+    }
+
+    bool find(const StringRef &key, StringRef &value) const {
+        for (std::size_t i = count; i > 0; i--) {
+            if (keys[i - 1] == key) {
+                value = values[i - 1];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::size_t size() const { return count; }
+    const StringRef &key(std::size_t index) const { return keys[index]; }
+    const StringRef &value(std::size_t index) const { return values[index]; }
+
+private:
+    StringRef keys[MAX_HEADERS];
+    StringRef values[MAX_HEADERS];
+    std::size_t count;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "FrameBuffer.h"
+
+// Pool of threads that process received frames off the reader thread. Each worker has its own
+// bounded queue and handles its frames in the order they were dispatched, so frames routed to
+// the same worker (e.g. by channel) keep their order. dispatch() blocks while the worker's
+// queue is full, which stops reading and lets TCP backpressure reach the sender.
+class FrameWorkers
+{
+public:
+    typedef std::function<void(std::size_t worker, const FrameRef &frame)> Handler;
+
+    static const std::size_t QUEUE_CAPACITY = 256; // Frames waiting per worker
+
+    FrameWorkers(std::size_t count, Handler handler);
+    ~FrameWorkers(); // Processes the queued frames, then joins the workers
+
+    std::size_t size() const { return workers.size(); }
+    void dispatch(std::size_t worker, const FrameRef &frame); // Called by one thread
+    void drain();                                             // Waits until the frames dispatched so far were handled
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable ready; // Worker: a frame was queued or stopping
+        std::condition_variable space; // Dispatcher and drain(): a frame was handled
+        std::deque<FrameRef> queue;
+        std::uint64_t dispatched;      // Frames ever queued
+        std::uint64_t handled;         // Frames ever handled, so drain() does not wait for later ones
+        bool stopping;
+        std::thread thread;
+
+        Worker() : mutex(), ready(), space(), queue(), dispatched(0), handled(0), stopping(false), thread() {}
+    };
+
+    Handler handler;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    FrameWorkers(const FrameWorkers &) = delete;
+    FrameWorkers &operator=(const FrameWorkers &) = delete;
+
+    void run(std::size_t index);
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <cstdint>
+#include "StringRef.h"
+
+// Compact replacement for the general_information map of an event.
+// The known boolean keys are compiled into two bitsets (present / true); any other key,
+// or a known key with a value other than "true"/"false", goes to an overflow vector
+// that is only allocated when needed. Iteration visits keys in std::map order.
+class GeneralInformation
+{
+public:
+    enum Key { ACTIVE = 0, FORCES_ARRIVAL_AT_SCENE = 1, KNOWN_KEY_COUNT = 2 };
+
+    GeneralInformation();
+    GeneralInformation(const std::map<std::string, std::string> &entries); // Compiles an existing map
+    GeneralInformation(std::uint8_t presentBits, std::uint8_t valueBits);  // Known flags only, as stored by bits()
+    GeneralInformation(const GeneralInformation &other);
+    GeneralInformation(GeneralInformation &&other);
+    GeneralInformation &operator=(const GeneralInformation &other);
+    GeneralInformation &operator=(GeneralInformation &&other);
+
+    void set(const StringRef &key, const StringRef &value); // Adds or replaces an entry (no allocation for known flags)
+
+    bool has(Key key) const { return (present >> key) & 1; }   // Whether a known key is set to a boolean
+    bool isTrue(Key key) const { return (values >> key) & 1; } // Whether a known key is "true"
+
+    std::uint8_t presentBits() const { return present; } // Raw flag bits, for binary storage
+    std::uint8_t valueBits() const { return values; }
+
+    std::size_t size() const;        // Number of entries
+    std::size_t memoryUsage() const; // Heap bytes owned (0 without overflow)
+
+    // Calls visit(key, value) for every entry in ascending key order.
+    template <typename Visitor>
+    void forEach(Visitor visit) const;
+
+    // Calls visit(key, value) for the entries that are not stored as flag bits.
+    template <typename Visitor>
+    void forEachOverflow(Visitor visit) const {
+        if (!overflow) return;
+        for (const std::pair<std::string, std::string> &entry : *overflow) {
+            visit(entry.first, entry.second);
+        }
+    }
+
+    static const char *keyName(Key key); // "active" / "forces_arrival_at_scene"
+
+private:
+    typedef std::vector<std::pair<std::string, std::string>> Overflow; // Sorted by key
+
+    std::uint8_t present;               // Bit per known key holding a boolean
+    std::uint8_t values;                // Bit per known key that is "true"
+    std::unique_ptr<Overflow> overflow; // Other entries, null when there are none
+
+    static bool knownKey(const StringRef &key, Key &known);
+    void eraseOverflow(const std::string &key);
+};
+
+template <typename Visitor>
+void GeneralInformation::forEach(Visitor visit) const {
+    static const std::string TRUE_TEXT("true"), FALSE_TEXT("false");
+    static const std::string NAMES[KNOWN_KEY_COUNT] = {keyName(ACTIVE), keyName(FORCES_ARRIVAL_AT_SCENE)};
+
+    // Known keys are already sorted by name; merge them with the sorted overflow.
+    std::size_t next = 0;
+    std::size_t overflowSize = overflow ? overflow->size() : 0;
+    for (int key = 0; key < KNOWN_KEY_COUNT; key++) {
+        if (!((present >> key) & 1)) continue;
+        while (next < overflowSize && (*overflow)[next].first < NAMES[key]) {
+            visit((*overflow)[next].first, (*overflow)[next].second);
+            next++;
+        }
+        visit(NAMES[key], ((values >> key) & 1) ? TRUE_TEXT : FALSE_TEXT);
+    }
+    for (; next < overflowSize; next++) {
+        visit((*overflow)[next].first, (*overflow)[next].second);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Latency distribution in log-linear buckets, as HdrHistogram: every power of two is split
+// into 2^SUB_BITS equal buckets, so any value up to 2^63 ns is kept within 1/32 (~3%) in a
+// fixed 15 KB, and recording is a few shifts and an increment. Values are nanoseconds.
+class LatencyHistogram
+{
+public:
+    static const unsigned SUB_BITS = 5;
+
+    LatencyHistogram();
+    void record(long long nanoseconds); // Negative values (clocks out of sync) count as 0
+    void reset();
+
+    std::uint64_t count() const { return total; }
+    std::uint64_t negatives() const { return negativeCount; }
+    long long min() const { return total ? minimum : 0; }
+    long long max() const { return maximum; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0; }
+    long long percentile(double fraction) const; // Highest value of the bucket holding that rank
+
+    static long long now(); // CLOCK_REALTIME in nanoseconds, the value of a timestamp header
+
+private:
+    std::vector<std::uint64_t> counts; // (64 - SUB_BITS + 1) groups of 2^SUB_BITS buckets
+    std::uint64_t total;
+    std::uint64_t negativeCount;
+    long long minimum;
+    long long maximum;
+    long double sum;
+
+    static std::size_t bucketOf(std::uint64_t value);
+    static std::uint64_t highestIn(std::size_t bucket);
+};
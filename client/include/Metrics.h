@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <ostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+
+// Process-wide client metrics. Every thread updates its own slot of counters and log2
+// histograms with plain relaxed stores (no locked instructions, no shared cache lines);
+// a read sums the slots of the live threads and the totals of the exited ones. Queue depths
+// are the difference of two counters (in - out), so they need no gauge updates either.
+class Metrics
+{
+public:
+    enum Counter {
+        FRAMES_RECEIVED, BYTES_RECEIVED, FRAMES_SENT, BYTES_SENT,
+        EVENTS_STORED, RECEIPTS,
+        READER_QUEUED, READER_TAKEN, // Frames pushed to / popped from the reader -> dispatcher ring
+        WORKER_QUEUED, WORKER_DONE,  // MESSAGE frames dispatched to / stored by the workers
+        COUNTER_COUNT
+    };
+    enum Histogram {
+        FRAME_PROCESSING, // Parsing and handling one received frame
+        SEND,             // Framing and writing one frame
+        RECEIPT_LATENCY,  // Request sent -> its RECEIPT handled
+        HISTOGRAM_COUNT
+    };
+    static const std::size_t BUCKETS = 40; // Bucket i counts durations below 2^i ns (the last one: all others)
+
+    struct Totals {
+        std::uint64_t counters[COUNTER_COUNT];
+        std::uint64_t buckets[HISTOGRAM_COUNT][BUCKETS];
+        std::uint64_t sums[HISTOGRAM_COUNT]; // Nanoseconds
+    };
+
+    static void add(Counter counter, std::uint64_t amount = 1);
+    static void observe(Histogram histogram, std::uint64_t nanoseconds);
+    static std::uint64_t nanosSince(std::uint64_t start) { return now() - start; }
+    static std::uint64_t now(); // Steady clock in nanoseconds
+
+    static Totals read();
+    static void print(std::ostream &out);         // The "stats" command output
+    static void writePrometheus(std::ostream &out); // Text exposition format 0.0.4
+    static bool dumpPrometheus(const std::string &path); // Written next to path, then renamed over it
+};
+
+// Rewrites a Prometheus text file every interval, e.g. for node_exporter's textfile
+// collector, and once more when destroyed.
+class MetricsDumper
+{
+public:
+    MetricsDumper(const std::string &path, long long intervalMs);
+    ~MetricsDumper();
+
+private:
+    std::string path;
+    long long intervalMs;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::thread thread;
+
+    MetricsDumper(const MetricsDumper &) = delete;
+    MetricsDumper &operator=(const MetricsDumper &) = delete;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include "EventStore.h"
+
+// Ad-hoc filter and count over the stored events of one channel:
+//
+//   {channel} [where {field} {op} {value} [and ...]] [group by {field}] [--from {epoch}] [--to {epoch}]
+//
+// Fields: city, user, name, date_time, active, forces_arrival_at_scene.
+// Ops: = != < <= > >= (ordering only on date_time). Values with spaces go in double quotes.
+// Runs over the store's column arrays in blocks: each predicate narrows a byte mask with a
+// branch-free loop, and string predicates compare dictionary (interned) IDs. A --from/--to
+// window (inclusive) is looked up in the store's time index instead of scanning every row.
+class Query
+{
+public:
+    enum Field { CITY, USER, NAME, DATE_TIME, ACTIVE, FORCES_ARRIVAL_AT_SCENE, NO_FIELD };
+    enum Op { EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+
+    struct Predicate {
+        Field field;
+        Op op;
+        long long number; // date_time bound
+        InternId id;      // city, user or name
+        bool known;       // False if the string was never seen, so nothing can equal it
+        bool flag;        // Expected value of active / forces_arrival_at_scene
+    };
+
+    struct Result {
+        std::size_t scanned;
+        std::size_t matched;
+        std::vector<std::pair<std::string, std::size_t>> groups; // Sorted by key, empty without group by
+        double seconds;
+    };
+
+    static const std::size_t BLOCK_ROWS = 1024; // Rows filtered per pass, the mask stays in L1
+
+    Query();
+
+    // Parses the text after "query". Returns false and sets error on invalid input.
+    static bool parse(const std::string &text, Query &query, std::string &error);
+
+    Result run(const EventStore &store) const;
+
+    const std::string &getChannel() const { return channel; }
+    Field getGroupBy() const { return groupBy; }
+    static const char *fieldName(Field field);
+
+    // Removes "--from {epoch}" and "--to {epoch}" from tokens, setting the bounds they give.
+    static bool takeRange(std::vector<std::string> &tokens, long long &from, long long &to, std::string &error);
+
+private:
+    std::string channel;
+    std::vector<Predicate> predicates;
+    Field groupBy;
+    bool hasRange;
+    long long from;
+    long long to;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <map>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "StringInterner.h"
+
+// Event counts of one channel per (time bucket, city), kept up to date as events arrive so
+// rate charts never rescan the stored events. Buckets are [start, start + width) in seconds
+// of event time. Like the sketches, rollups cover every event received, evicted or not.
+class RollupTable
+{
+public:
+    struct Counts {
+        std::uint32_t total;
+        std::uint32_t active;         // general_information active = true
+        std::uint32_t forcesArrival;  // general_information forces_arrival_at_scene = true
+    };
+
+    static const long long DEFAULT_WIDTH = 3600;
+
+    explicit RollupTable(long long width);
+
+    void add(long long dateTime, InternId city, bool active, bool forcesArrival);
+
+    // Calls visit(bucketStart, city, counts) for every non-empty bucket, oldest bucket first.
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        for (const std::pair<const std::pair<long long, InternId>, Counts> &cell : cells) {
+            visit(cell.first.first, cell.first.second, cell.second);
+        }
+    }
+
+    long long width() const { return bucketWidth; }
+    std::size_t size() const { return cells.size(); }
+
+private:
+    long long bucketWidth;
+    std::map<std::pair<long long, InternId>, Counts> cells; // Keyed by (bucket start, city)
+
+    long long bucketStart(long long dateTime) const;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <cstddef>
+#include <boost/asio.hpp>
+#include "ConnectionHandler.h"
+#include "StompProtocol.h"
+
+// Named client sessions in one process, each with its own connection and protocol state.
+// Instead of a reader and a dispatcher thread per session, every session's socket is read
+// asynchronously by one shared pool of I/O threads, which parse its frames in place; a
+// session's frames are handled in order, one at a time. The pool starts with the first session.
+// Sessions are opened and removed by the command thread.
+class SessionManager
+{
+public:
+    struct Session {
+        std::string name;
+        std::string username;
+        std::unique_ptr<ConnectionHandler> connection;
+        std::unique_ptr<StompProtocol> protocol;
+        bool finished; // Reading stopped after logout, an ERROR or a lost connection (guarded by mutex)
+
+        Session() : name(), username(), connection(), protocol(), finished(false) {}
+    };
+
+    explicit SessionManager(std::size_t ioThreads);
+    ~SessionManager(); // Closes the remaining sessions and joins the I/O threads
+
+    // Connects a new session and starts reading its frames, after setup(protocol) applied the
+    // session's settings. Returns null if the connection failed.
+    Session *open(const std::string &name, const std::string &host, short port, const std::string &username,
+                  const std::function<void(StompProtocol &)> &setup);
+
+    Session *find(const std::string &name); // Null if absent; finished sessions are removed first
+    void waitFinished(Session &session);    // Blocks until the session stopped reading
+    void remove(const std::string &name);   // Closes the connection and frees the session's state
+    void print();                           // Lists the sessions and the I/O pool
+
+private:
+    boost::asio::io_service service;
+    std::unique_ptr<boost::asio::io_service::work> work; // Keeps the pool running while idle
+    std::vector<std::thread> threads;
+    std::size_t threadCount;
+
+    std::map<std::string, std::unique_ptr<Session>> sessions;
+    std::mutex mutex;                // Guards Session::finished
+    std::condition_variable stopped; // A session finished
+
+    SessionManager(const SessionManager &) = delete;
+    SessionManager &operator=(const SessionManager &) = delete;
+
+    void startThreads();
+    void reapFinished(); // Removes the sessions that finished on their own
+};
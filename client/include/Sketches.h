@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "StringInterner.h"
+
+// Distinct-count estimate in fixed memory (2^PRECISION one-byte registers, ~1.6% error).
+class HyperLogLog
+{
+public:
+    static const unsigned PRECISION = 12;
+
+    HyperLogLog();
+    void add(std::uint64_t hash); // hash must be well mixed
+    double estimate() const;
+    static double relativeError();
+
+private:
+    std::vector<std::uint8_t> registers;
+};
+
+// Frequency estimate that never undercounts; overcounts by at most total * e / WIDTH with
+// probability 1 - e^-DEPTH.
+class CountMinSketch
+{
+public:
+    static const std::size_t DEPTH = 4;
+    static const std::size_t WIDTH = 1024;
+
+    CountMinSketch();
+    std::uint32_t add(std::uint64_t hash); // Counts one occurrence and returns the new estimate
+    std::uint32_t estimate(std::uint64_t hash) const;
+
+private:
+    std::vector<std::uint32_t> counters; // DEPTH rows of WIDTH
+};
+
+// The K items with the highest estimated counts, kept in a min-heap on the estimate.
+class TopK
+{
+public:
+    static const std::size_t K = 10;
+
+    TopK();
+    void offer(InternId item, std::uint32_t count); // count is the item's current estimate
+    std::vector<std::pair<InternId, std::uint32_t>> items() const; // Highest first
+
+private:
+    std::vector<std::pair<std::uint32_t, InternId>> heap;
+};
+
+// Streaming statistics of one channel, O(1) per event and independent of the stored events.
+class ChannelSketch
+{
+public:
+    ChannelSketch();
+    void add(InternId user, InternId city);
+
+    std::uint64_t events() const { return count; }
+    double distinctUsers() const { return users.estimate(); }
+    double distinctCities() const { return cities.estimate(); }
+    std::vector<std::pair<InternId, std::uint32_t>> topCities() const { return cityTop.items(); }
+
+    static std::uint64_t hash(InternId id); // 64-bit mix of an ID
+
+private:
+    std::uint64_t count;
+    HyperLogLog users;
+    HyperLogLog cities;
+    CountMinSketch cityCounts;
+    TopK cityTop;
+};
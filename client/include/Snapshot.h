@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "EventStore.h"
+
+// Columnar binary export of the event store, laid out so that it can be memory-mapped and
+// scanned in place. All integers are little-endian and every column starts 8-byte aligned.
+//
+//   header    "STOMPSNP", u32 version, u32 reserved
+//   columns   see Column; their offsets and lengths are listed in the directory
+//   directory per column: u32 column id, u32 reserved, u64 offset, u64 length
+//   footer    u64 directory offset, u32 column count, u32 row count, "STOMPSNP"
+//
+// Rows are grouped by channel (in arrival order within a channel); CHANNEL_INDEX maps each
+// channel to its row range. String columns hold indexes into DICTIONARY.
+class Snapshot
+{
+public:
+    enum Column {
+        DICTIONARY = 1,       // u32 count, u32 offsets[count + 1], string bytes
+        CHANNEL_INDEX = 2,    // per channel: u32 dictionary id, u32 first row, u32 row count
+        CHANNEL_NAME = 3,     // u32[rows], "channel name" of the event body
+        USER = 4,             // u32[rows]
+        CITY = 5,             // u32[rows]
+        NAME = 6,             // u32[rows]
+        DATE_TIME = 7,        // i32[rows]
+        FLAGS = 8,            // u8 present bits[rows], u8 value bits[rows] (GeneralInformation::Key)
+        DESCRIPTION = 9,      // u64 offsets[rows + 1], bytes
+        OVERFLOW_ENTRIES = 10 // u32 first pair[rows + 1], then (u32 key id, u32 value id) pairs
+    };
+
+    static const std::uint32_t VERSION = 1;
+
+    // Writes the live events of the given channels to path (via a temporary file renamed over it).
+    // Returns false on I/O errors, leaving path unchanged.
+    static bool write(const std::string &path, const EventStore &store, const std::vector<InternId> &channels,
+                      std::size_t &rows);
+    static bool write(const std::string &path, const std::vector<const EventStore *> &stores,
+                      const std::vector<InternId> &channels, std::size_t &rows); // Channels found in any store
+
+    // Maps a snapshot and adds its events to store; descriptions stay views into the mapping.
+    // Returns false, having added nothing, if the file is missing or malformed.
+    static bool load(const std::string &path, EventStore &store, std::size_t &rows);
+    static bool load(const std::string &path, const EventStoreRouter &storeOf, std::size_t &rows); // Into storeOf(channel)
+};
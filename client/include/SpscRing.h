@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstddef>
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread.
+// The producer owns tail and the consumer owns head; each sits on its own cache line with the
+// side's cached copy of the other index, so a handoff costs one release store and, only when
+// the cached index runs out, one acquire load of the other line. Capacity must be a power of 2.
+// pop() spins briefly (on multi-core machines) and then parks on a condition variable; push()
+// notifies once per park, so the mutex stays off the fast path.
+template <typename T, std::size_t Capacity>
+class SpscRing
+{
+public:
+    static const std::size_t CACHE_LINE = 64;
+    static const int SPIN_LIMIT = 256; // Empty polls before the consumer parks
+
+    SpscRing() : slots(), tail(0), cachedHead(0), head(0), cachedTail(0), parked(false), mutex(), wake() {}
+
+    bool tryPush(T &&value) {
+        std::size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cachedHead == Capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (position - cachedHead == Capacity) return false;
+        }
+        slots[position & (Capacity - 1)] = std::move(value);
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &value) {
+        std::size_t position = head.load(std::memory_order_relaxed);
+        if (position == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (position == cachedTail) return false;
+        }
+        value = std::move(slots[position & (Capacity - 1)]);
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Blocks while the ring is full; the consumer is draining it then, so yielding suffices.
+    void push(T &&value) {
+        while (!tryPush(std::move(value))) {
+            std::this_thread::yield();
+        }
+        // Pairs with the fence in pop(): either the consumer sees the new tail or we see it parked.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            parked.store(false, std::memory_order_relaxed); // Later pushes stay on the fast path
+            wake.notify_one();
+        }
+    }
+
+    void pop(T &value) {
+        // Spinning only helps when the producer runs on another core meanwhile
+        static const int spins = std::thread::hardware_concurrency() > 1 ? SPIN_LIMIT : 0;
+        for (int spin = 0; spin < spins; spin++) {
+            if (tryPop(value)) return;
+        }
+        while (!tryPop(value)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            parked.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (tail.load(std::memory_order_relaxed) == head.load(std::memory_order_relaxed)) {
+                wake.wait(lock);
+            }
+            parked.store(false, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    T slots[Capacity];
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail; // Producer side
+    std::size_t cachedHead;
+
+    alignas(CACHE_LINE) std::atomic<std::size_t> head; // Consumer side
+    std::size_t cachedTail;
+
+    alignas(CACHE_LINE) std::atomic<bool> parked; // Consumer is waiting on wake
+    std::mutex mutex;
+    std::condition_variable wake;
+
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscRing capacity must be a power of 2");
+};
+
+template <typename T, std::size_t Capacity>
+const std::size_t SpscRing<T, Capacity>::CACHE_LINE;
@@ -4,22 +4,43 @@
 #include <vector>
 #include <unordered_map>
 #include "event.h"
+#include "EventStore.h"
+#include "EventLog.h"
+#include "SummaryCache.h"
+#include "FrameWorkers.h"
+#include "LatencyHistogram.h"
+#include "Metrics.h"
 #include "ConnectionHandler.h"
+#include "FrameBuffer.h"
+#include "FrameHeaders.h"
 
+#include <climits>
+#include <memory>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>   // For thread safety
 
 class StompProtocol
 {
 public:
-    StompProtocol(ConnectionHandler &handler); // Initializes the STOMP protocol handler.
+    // Initializes the STOMP protocol handler. With workers > 0, MESSAGE frames are parsed and
+    // stored by that many worker threads, each owning the store shard of the channels hashed to it.
+    StompProtocol(ConnectionHandler &handler, std::size_t workers = 0);
+    ~StompProtocol(); // Handles the frames still queued for the workers
 
     void connect(); // Sends a CONNECT frame to the server.
 
     void send(const std::string &command, const std::map<std::string, std::string> &headers, const std::string &body); // Sends a STOMP frame.
+    static std::string formatFrame(const std::string &command, const std::map<std::string, std::string> &headers,
+                                   const std::string &body); // The frame send writes, before the null terminator
 
     void parseFrame(const std::string &message); // Parses a received STOMP frame.
+    void parseFrame(const FrameRef &frame);      // Parses a received STOMP frame in place, events keep views into it.
+                                                 // MESSAGE frames go to the worker of their destination, if any.
+    void drainWorkers();                         // Waits until the workers stored the MESSAGEs dispatched so far
 
-    void summarizeEmergencyChannel(const std::string &channel, const std::string &user, const std::string &filePath); // Summarizes stored events and saves to file.
+    void summarizeEmergencyChannel(const std::string &channel, const std::string &user, const std::string &filePath,
+                                   long long from = LLONG_MIN, long long to = LLONG_MAX); // Summarizes stored events (optionally in a date_time window) and saves to file.
 
     std::string epochToDate(int epochTime) const; // Converts epoch time to a formatted date string.
 
@@ -31,6 +52,7 @@ public:
     int getNextReceiptId(); // Generates a unique receipt ID
 
     void storeReceipt(int receiptId, const std::string& requestType); // Stores the mapping between receipt ID and request type
+    bool waitForReceipts(long long timeoutMs); // Waits for CONNECTED and every stored receipt; false on timeout or stop
 
     void storeSubscriptionId(const std::string& channel, int subscriptionId); // Stores subscription ID used for subscribing to a channel
     int getSubscriptionId(const std::string& channel); // Retrieves the subscription ID used for subscribing to a channel
@@ -43,32 +65,76 @@ public:
     
     bool hasSubscription(const std::string& channel); // Check if the client is subscribed to a channel
 
+    void setMemoryBudget(size_t bytes);       // Limits bytes of stored events (0 = unlimited)
+    void setEventTtl(long long seconds);      // Expires events older than the newest date_time minus seconds (0 = off)
+    void setFreeOnUnsubscribe(bool enabled);  // Frees a channel's events when exiting it
+    void setEventArena(bool enabled, bool hugePages); // Packs stored descriptions into per-channel arenas
+    void printMemoryUsage();                  // Prints store usage, arena and RSS, and eviction counts
+
+    bool openEventLog(const std::string &directory, bool replay); // Replays the log in directory into the store (if replay), then appends to it
+    void closeEventLog();                            // Commits and stops logging received events
+    void printEventLogStatus();                      // Prints segments, disk usage and commit counts
+
+    void writeSnapshot(const std::string &channel, const std::string &filePath); // Exports a channel ("*" = all) as a columnar file
+    bool loadSnapshot(const std::string &filePath);                              // Adds the events of a snapshot to the store
+
+    void runQuery(const std::string &text); // Parses and runs a query (see Query.h), prints counts and scan rate
+    void search(const std::string &channel, const std::string &terms); // Prints events containing all terms
+    void printChannelStats(const std::string &channel); // Prints the channel's sketch estimates (see Sketches.h)
+    void setRollupWidth(long long seconds);             // Bucket width of the rollups (see Rollup.h)
+    void printRollup(const std::string &channel, const std::string &filePath); // Prints, or exports as CSV if filePath is set
+
+    void setLatencyTracking(bool enabled);             // Stamps reports with a timestamp header and records stamped MESSAGEs
+    bool isLatencyTracking() const;
+    void printLatency(const std::string &channel);     // Prints publish -> delivery latency ("" = every channel)
+    void resetLatency(const std::string &channel);     // Clears the histograms ("" = every channel)
+
 private:
     ConnectionHandler &connectionHandler; // Handles communication with the server.
-    bool connected;    // Indicates if the client is connected.
-    bool stopCommunication;  // Signals the communication thread to stop.
-    bool errorOccured;  // Indicates if an error occurred.
+    // Flags shared by the keyboard, dispatcher and worker threads. errorOccured is written
+    // before stopCommunication is released, so a thread that sees the stop also sees the error.
+    std::atomic<bool> connected;         // Indicates if the client is connected.
+    std::atomic<bool> stopCommunication; // Signals the communication threads to stop.
+    std::atomic<bool> errorOccured;      // Indicates if an error occurred.
+    std::atomic<bool> latencyTracking;   // Read once per MESSAGE, so tracking costs nothing while off.
 
     
     int idCounter;       // Tracks unique subscription IDs per client
     int receiptCounter;  // Tracks unique receipt IDs per client
 
-    std::unordered_map<std::string, std::vector<Event>> eventSummary; // Stores received events.
+    // Received events, split by channel hash into one shard per worker (a single shard without
+    // workers). A shard is written only by its worker; its mutex orders that against commands.
+    struct StoreShard {
+        EventStore eventSummary;   // Stores received events per interned channel, within the memory policies.
+        SummaryCache summaryCache; // Rendered full-history summaries of the shard's channels
+        std::unordered_map<InternId, LatencyHistogram> latency; // Publish -> delivery of timestamped MESSAGEs per channel
+        std::mutex storeMutex;
+
+        StoreShard() : eventSummary(), summaryCache(), latency(), storeMutex() {}
+    };
+
+    std::vector<std::unique_ptr<StoreShard>> shards;
+    std::unique_ptr<EventLog> eventLog; // Optional on-disk copy of received events (guarded by every storeMutex)
+    size_t memoryBudget;                // Total budget, split evenly over the shards
 
     // Used to match RECEIPT frames to their corresponding requests, and know which request by the client the receipt is for.
-    std::unordered_map<int, std::string> receiptMap; // Maps receipt ID → request type
+    std::unordered_map<int, std::string> receiptMap; // Maps receipt ID → request type (guarded by receiptMutex)
+    std::unordered_map<int, std::uint64_t> receiptSentAt; // Receipt ID → Metrics::now() when stored (guarded by receiptMutex)
+    std::mutex receiptMutex;
+    std::condition_variable receiptsChanged; // A receipt arrived, or communication stopped
 
     // Used to track the subscription ID the client useed for each channel, to know which ID to use for UNSUBSCRIBE.
-    std::unordered_map<std::string, int> subscriptionIds;  // Maps channel → subscription ID
+    std::unordered_map<InternId, int> subscriptionIds;  // Maps interned channel → subscription ID
 
-    // Mutex for connection status
-    std::mutex connectionMutex; 
+    std::unique_ptr<FrameWorkers> workers; // Parse and store MESSAGE frames; null = on the reader thread
 
-    // Mutex for error status
-    std::mutex errorMutex; 
+    StoreShard &shardOf(InternId channel);                      // The shard a channel's events go to
+    std::vector<std::unique_lock<std::mutex>> lockAllShards(); // For commands that span every channel
+    EventStoreRouter shardRouter();                            // Routes replayed and loaded events
+    void processFrame(const FrameRef &frame);                  // Parses a frame and calls its handler
 
     void handleConnected();                                                                         // Handles a CONNECTED frame.
-    void handleMessage(const std::map<std::string, std::string> &headers, const std::string &body); // Handles MESSAGE frames.
-    void handleError(const std::map<std::string, std::string> &headers, const std::string &body);   // Handles ERROR frames.
-    void handleReceipt(const std::map<std::string, std::string> &headers);                          // Handles RECEIPT frames.
+    void handleMessage(const FrameHeaders &headers, const FrameRef &frame, const StringRef &body); // Handles MESSAGE frames.
+    void handleError(const FrameHeaders &headers, const StringRef &body);                          // Handles ERROR frames.
+    void handleReceipt(const FrameHeaders &headers);                                               // Handles RECEIPT frames.
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+
+typedef std::uint32_t InternId; // Stable ID of an interned string
+
+// Process-wide table mapping repeated strings (channels, users, cities, event names)
+// to stable integer IDs. Each distinct string is stored once and never moves, so
+// lookup() is lock-free and the returned reference stays valid for the process lifetime.
+class StringInterner
+{
+public:
+    static StringInterner &instance(); // The shared table used by events and the protocol
+
+    StringInterner();
+    ~StringInterner();
+
+    InternId intern(const std::string &value);              // Returns the ID of value, adding it if new
+    InternId intern(const char *data, std::size_t length);  // Same, without building a std::string first
+    bool find(const std::string &value, InternId &id) const; // Looks up an ID without adding the string
+    const std::string &lookup(InternId id) const;           // Returns the string of an ID
+
+    std::size_t size() const;        // Number of distinct strings
+    std::size_t memoryUsage() const; // Approximate bytes held by the table
+
+private:
+    static const unsigned BLOCK_BITS = 10;
+    static const std::size_t BLOCK_SIZE = std::size_t(1) << BLOCK_BITS; // Strings per storage block
+    static const std::size_t MAX_BLOCKS = std::size_t(1) << 16;         // Up to 64M distinct strings
+
+    StringInterner(const StringInterner &) = delete;
+    StringInterner &operator=(const StringInterner &) = delete;
+
+    std::atomic<std::string *> *blocks; // Fixed array of storage blocks, filled on demand
+    std::atomic<std::uint32_t> count;   // Number of published strings
+    mutable std::mutex mutex;           // Guards slots and appends
+    std::vector<std::uint32_t> slots;   // Open-addressing hash table of ID + 1 (0 = empty)
+    std::size_t stringBytes;            // Heap bytes of stored strings (beyond sizeof)
+
+    std::size_t probe(const char *data, std::size_t length, std::uint64_t hash) const; // Slot index for a string
+    void grow(); // Doubles the hash table
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+#include <ostream>
+
+// Non-owning view of a run of characters (pointer + length), used to parse frames in place.
+class StringRef
+{
+public:
+    StringRef() : ptr(""), len(0) {}
+    StringRef(const char *data, std::size_t length) : ptr(data), len(length) {}
+    StringRef(const char *text) : ptr(text), len(std::strlen(text)) {}
+    StringRef(const std::string &text) : ptr(text.data()), len(text.size()) {}
+
+    const char *data() const { return ptr; }
+    std::size_t size() const { return len; }
+    std::size_t length() const { return len; }
+    bool empty() const { return len == 0; }
+    char operator[](std::size_t index) const { return ptr[index]; }
+
+    const char *begin() const { return ptr; }
+    const char *end() const { return ptr + len; }
+
+    std::string str() const { return std::string(ptr, len); }
+
+    // Clamped like std::string::substr, but without copying.
+    StringRef substr(std::size_t pos, std::size_t count = std::string::npos) const {
+        if (pos > len) pos = len;
+        if (count > len - pos) count = len - pos;
+        return StringRef(ptr + pos, count);
+    }
+
+    std::size_t find(char ch, std::size_t from = 0) const {
+        for (std::size_t i = from; i < len; i++) {
+            if (ptr[i] == ch) return i;
+        }
+        return std::string::npos;
+    }
+
+    bool operator==(const StringRef &other) const {
+        return len == other.len && std::memcmp(ptr, other.ptr, len) == 0;
+    }
+    bool operator!=(const StringRef &other) const { return !(*this == other); }
+
+    bool operator<(const StringRef &other) const {
+        int order = std::memcmp(ptr, other.ptr, len < other.len ? len : other.len);
+        return order != 0 ? order < 0 : len < other.len;
+    }
+
+private:
+    const char *ptr;
+    std::size_t len;
+};
+
+inline std::ostream &operator<<(std::ostream &out, const StringRef &text) {
+    return out.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+inline std::string &operator+=(std::string &out, const StringRef &text) {
+    return out.append(text.data(), text.size());
+}
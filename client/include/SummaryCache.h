@@ -0,0 +1,63 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+#include "EventStore.h"
+
+// Rendered full-history summaries per (channel, user), so dashboards polling an unchanged
+// summary cost a stat call. An entry remembers the store's version counters it was built at:
+//  - nothing new for the user and nothing evicted: the cached bytes are reused as they are;
+//  - only new reports, all sorting after the cached ones: they are formatted and appended, and
+//    if the header kept its length the file is patched in place instead of rewritten;
+//  - anything else (eviction, out-of-order report): the summary is rebuilt from the store.
+// Cached event pointers stay valid while the channel's removal version is unchanged, since
+// the store only moves or frees events when evicting them. Not thread-safe; callers hold the
+// store lock.
+class SummaryCache
+{
+public:
+    enum Outcome { UNCHANGED, APPENDED, REBUILT };
+
+    static const std::size_t MAX_ENTRIES = 16; // The least recently used entry goes first
+
+    SummaryCache();
+
+    // Writes the summary of user's events in the channel to filePath, in SummaryWriter's format.
+    // Returns false if the file could not be written.
+    bool write(const EventStore &store, const std::string &channel, InternId channelId, InternId userId,
+               const std::string &filePath, Outcome &outcome);
+
+    void clear();
+
+private:
+    struct Entry {
+        std::uint64_t userVersion;
+        std::uint64_t removalVersion;
+        std::uint64_t endSeq;               // Events from here on are not in the entry yet
+        std::vector<const Event *> events;  // Sorted as in the file
+        int activeCount;
+        int forcesArrivalCount;
+        std::string reports;                // Rendered reports, without the header
+        std::string filePath;               // Last file written from the entry
+        std::size_t headerBytes;
+        std::size_t fileBytes;
+        std::uint64_t lastUse;
+
+        Entry() : userVersion(0), removalVersion(0), endSeq(0), events(), activeCount(0), forcesArrivalCount(0),
+                  reports(), filePath(), headerBytes(0), fileBytes(0), lastUse(0) {}
+    };
+
+    std::map<std::pair<InternId, InternId>, Entry> entries;
+    std::uint64_t useClock;
+
+    static void count(const Event &event, Entry &entry);
+    static void rebuild(const EventStore &store, InternId channelId, InternId userId, Entry &entry);
+    static bool append(const EventStore &store, InternId channelId, InternId userId, Entry &entry);
+    static bool fileMatches(const Entry &entry, const std::string &filePath);
+    static bool patchFile(const Entry &entry, const std::string &header, std::size_t reportsBefore);
+    void evictLeastRecent();
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "event.h"
+
+// Renders the summary report of a channel into large in-memory buffers and writes them
+// with a few write calls. Big reports are formatted in parallel chunks and written in order.
+class SummaryWriter
+{
+public:
+    static const std::size_t PARALLEL_THRESHOLD = 65536; // Reports needed before formatting in parallel
+    static const std::size_t MAX_CHUNKS = 8;             // Upper bound on formatting threads
+
+    SummaryWriter(const std::string &channel, int activeCount, int forcesArrivalCount);
+
+    // Writes the header and the (already sorted) reports to filePath, replacing its contents.
+    // Returns false if the file could not be opened or written.
+    bool write(const std::string &filePath, const std::vector<const Event *> &events) const;
+
+    // Appends the "Channel ... Event Reports:" header for the given number of reports.
+    void appendHeader(std::string &out, std::size_t total) const;
+
+    // Appends reports [begin, end) of events, numbered from begin + 1.
+    static void appendReports(std::string &out, const std::vector<const Event *> &events, std::size_t begin, std::size_t end);
+
+    // Same, formatting big ranges in parallel chunks that are then appended in order.
+    static void appendReportsParallel(std::string &out, const std::vector<const Event *> &events, std::size_t begin, std::size_t end);
+
+    static void appendDecimal(std::string &out, unsigned long long value); // Integer formatting without streams
+
+    // Writes the buffers to filePath in order, replacing its contents.
+    static bool writeBuffers(const std::string &filePath, const std::vector<const std::string *> &buffers);
+
+    // Report order: by date_time, then by event name.
+    static bool before(const Event *a, const Event *b) {
+        if (a->get_date_time() == b->get_date_time()) {
+            return a->get_name() < b->get_name();
+        }
+        return a->get_date_time() < b->get_date_time();
+    }
+
+private:
+    std::string channel;
+    int activeCount;
+    int forcesArrivalCount;
+
+    // Formats reports [begin, end) into one or more ordered chunks.
+    static void formatChunks(const std::vector<const Event *> &events, std::size_t begin, std::size_t end, std::vector<std::string> &chunks);
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include "StringRef.h"
+
+// Inverted index from lower-cased alphanumeric tokens to the sequence numbers of the events
+// that contain them. Postings are appended in ascending order as delta varints, with a skip
+// entry every SKIP_INTERVAL postings so intersections can jump ahead instead of decoding.
+class TextIndex
+{
+public:
+    static const std::size_t SKIP_INTERVAL = 64;
+    static const std::size_t MAX_TOKEN = 64; // Longer tokens are cut
+
+    TextIndex();
+
+    void add(std::uint64_t seq, const StringRef &text); // seq must not decrease between calls
+
+    // Sequence numbers of the events containing every term, ascending.
+    std::vector<std::uint64_t> search(const std::vector<std::string> &terms) const;
+
+    void prune(std::uint64_t firstSeq); // Drops postings below firstSeq (trimmed events)
+
+    std::size_t memoryUsage() const { return bytes; } // Approximate heap bytes
+    std::size_t termCount() const { return terms.size(); }
+
+    static void tokenize(const StringRef &text, std::vector<std::string> &tokens); // Same rules as add()
+
+private:
+    struct Skip {
+        std::uint64_t seq;     // Posting at index
+        std::uint32_t index;
+        std::uint32_t offset;  // Byte offset just after that posting
+    };
+
+    struct Postings {
+        std::vector<std::uint8_t> bytes;
+        std::vector<Skip> skips;
+        std::uint64_t last;
+        std::uint32_t count;
+
+        Postings() : bytes(), skips(), last(0), count(0) {}
+        void append(std::uint64_t seq);
+    };
+
+    class Cursor;
+
+    std::unordered_map<std::string, Postings> terms;
+    std::size_t bytes;
+    std::string token; // Scratch for add()
+
+    void addToken(std::uint64_t seq);
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "StringInterner.h"
+
+// Hashed timing wheel driven by event time (date_time seconds) rather than the wall clock.
+// Each slot covers 'granularity' seconds; entries further away than one rotation stay in
+// their slot until the wheel reaches their expiry.
+class TimerWheel
+{
+public:
+    struct Entry {
+        long long expiry;   // Event time at which the entry fires
+        InternId channel;   // Channel of the stored event
+        std::uint64_t seq;  // Sequence number of the event within its channel
+    };
+
+    TimerWheel(std::size_t slotCount, long long granularity);
+
+    void reset(long long granularity); // Drops all entries and changes the slot width
+    void schedule(const Entry &entry); // Entry must expire after the current time
+    std::size_t size() const { return count; }
+
+    // Moves the wheel to 'now' and calls expire(entry) for the entries that became due.
+    template <typename Expire>
+    void advance(long long now, Expire expire);
+
+private:
+    std::vector<std::vector<Entry>> slots;
+    long long granularity;
+    long long currentTick; // Tick the wheel was last advanced to
+    bool started;
+    std::size_t count;
+
+    long long tickOf(long long time) const; // Floor division by granularity
+};
+
+template <typename Expire>
+void TimerWheel::advance(long long now, Expire expire) {
+    long long target = tickOf(now);
+    if (!started) {
+        currentTick = target;
+        started = true;
+        return;
+    }
+    if (target <= currentTick) {
+        return; // Entries fire when their tick has fully passed (at most one slot late)
+    }
+
+    // Sweep the ticks passed since the last advance, each slot at most once.
+    long long size = static_cast<long long>(slots.size());
+    long long first = target - currentTick > size ? target - size : currentTick;
+    for (long long tick = first; tick < target; tick++) {
+        std::vector<Entry> &slot = slots[static_cast<std::size_t>(((tick % size) + size) % size)];
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < slot.size(); i++) {
+            if (slot[i].expiry <= now) {
+                count--;
+                expire(slot[i]);
+            } else {
+                slot[kept++] = slot[i]; // Belongs to a later rotation
+            }
+        }
+        slot.resize(kept);
+    }
+    currentTick = target;
+}
@@ -4,36 +4,59 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include "StringInterner.h"
+#include "GeneralInformation.h"
+#include "FrameBuffer.h"
 
 class Event
 {
 private:
-    // name of channel
-    std::string channel_name;
-    // city of the event 
-    std::string city;
-    // name of the event
-    std::string name;
+    // name of channel (interned)
+    InternId channel_name;
+    // city of the event (interned)
+    InternId city;
+    // name of the event (interned)
+    InternId name;
     // time of the event in seconds
     int date_time;
-    // description of the event
-    std::string description;
-    // map of all the general information
-    std::map<std::string, std::string> general_information;
-    std::string eventOwnerUser;
+    // description of the event, a view into the frame it was received in
+    FrameRef frame;
+    std::uint32_t descriptionOffset;
+    std::uint32_t descriptionLength;
+    // all the general information (known flags as bits, other keys in overflow)
+    GeneralInformation general_information;
+    // user that reported the event (interned)
+    InternId eventOwnerUser;
+
+    explicit Event(const FrameRef &whole_body); // Parses a frame that holds only the body
 
 public:
-    Event(std::string channel_name, std::string city, std::string name, int date_time, std::string description, std::map<std::string, std::string> general_information);
+    Event(std::string channel_name, std::string city, std::string name, int date_time, std::string description, GeneralInformation general_information);
     Event(const std::string & frame_body);
+    Event(const FrameRef &frame, const StringRef &frame_body); // Parses a body held in frame without copying it
+    Event(InternId channel_name, InternId city, InternId name, int date_time, const FrameRef &frame,
+          const StringRef &description, GeneralInformation general_information, InternId eventOwnerUser); // From stored parts
+    Event(const Event &other) = default;
+    Event(Event &&other) = default;
+    Event &operator=(const Event &other) = default;
+    Event &operator=(Event &&other) = default;
     virtual ~Event();
     void setEventOwnerUser(std::string setEventOwnerUser);
     const std::string &getEventOwnerUser() const;
     const std::string &get_channel_name() const;
     const std::string &get_city() const;
-    const std::string &get_description() const;
+    StringRef get_description() const;
     const std::string &get_name() const;
     int get_date_time() const;
-    const std::map<std::string, std::string> &get_general_information() const;
+    InternId get_channel_id() const;
+    InternId get_city_id() const;
+    InternId get_name_id() const;
+    InternId getEventOwnerUserId() const;
+    const GeneralInformation &get_general_information() const;
+    std::size_t memoryUsage() const; // Heap bytes owned or retained by the event
+    void releaseStorage();           // Drops the retained frame and overflow entries (for evicted events)
+    bool hasExternalStorage() const; // Whether the description lives outside the malloc heap (log mapping, arena)
+    void moveDescription(const FrameRef &storage, const StringRef &copy); // Points the description at copy, held by storage
 };
 
 // an object that holds the names of the teams and a vector of events, to be returned by the parseEventsFile function
@@ -43,4 +66,8 @@ struct names_and_events {
 };
 
 // function that parses the json file and returns a names_and_events object
+// (a .ndjson or .jsonl path holds a {"channel_name": ...} line, then one event object per line)
 names_and_events parseEventsFile(std::string json_path);
+
+// the body of the SEND frame that reports event as user
+std::string formatEventBody(const std::string &user, const Event &event);
@@ -0,0 +1,86 @@
+#include "../include/CommandScript.h"
+#include "../include/keyboardInput.h"
+#include <fstream>
+
+CommandScript::CommandScript() : entries(), loops(), position(0) {}
+
+bool CommandScript::load(const std::string &path, std::string &error) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        error = "Could not open script " + path;
+        return false;
+    }
+
+    entries.clear();
+    loops.clear();
+    position = 0;
+    std::vector<std::size_t> open; // Indices of unmatched REPEAT entries
+    std::string text;
+    for (std::size_t line = 1; std::getline(file, text); line++) {
+        if (!text.empty() && text[text.size() - 1] == '\r') {
+            text.erase(text.size() - 1);
+        }
+        text.erase(0, text.find_first_not_of(" \t")); // Indentation inside repeat blocks
+        std::vector<std::string> tokens;
+        KeyboardInput::split_str(text, ' ', tokens);
+        if (tokens.empty() || tokens[0][0] == '#') continue;
+
+        Entry entry = {COMMAND, line, text, 0, 0};
+        if (tokens[0] == "repeat") {
+            try {
+                entry.count = tokens.size() == 2 ? std::stoull(tokens[1]) : 0;
+            } catch (const std::exception &) {
+                tokens.clear();
+            }
+            if (tokens.size() != 2) {
+                error = "line " + std::to_string(line) + ": repeat needs 1 arg: {count}";
+                return false;
+            }
+            entry.kind = REPEAT;
+            open.push_back(entries.size());
+        } else if (tokens[0] == "end" && tokens.size() == 1) {
+            if (open.empty()) {
+                error = "line " + std::to_string(line) + ": end without repeat";
+                return false;
+            }
+            entry.kind = END;
+            entry.match = open.back();
+            entries[open.back()].match = entries.size();
+            open.pop_back();
+        }
+        entries.push_back(entry);
+    }
+    if (!open.empty()) {
+        error = "line " + std::to_string(entries[open.back()].line) + ": repeat without end";
+        return false;
+    }
+    return true;
+}
+
+bool CommandScript::next(Command &command) {
+    while (position < entries.size()) {
+        const Entry &entry = entries[position];
+        if (entry.kind == REPEAT) {
+            if (entry.count == 0) {
+                position = entry.match + 1;
+            } else {
+                loops.push_back(Loop{position, entry.count});
+                position++;
+            }
+        } else if (entry.kind == END) {
+            Loop &loop = loops.back();
+            if (--loop.remaining > 0) {
+                position = loop.begin + 1;
+            } else {
+                loops.pop_back();
+                position++;
+            }
+        } else {
+            command.line = entry.line;
+            command.text = entry.text;
+            position++;
+            return true;
+        }
+    }
+    return false;
+}
@@ -1,4 +1,8 @@
 #include "../include/ConnectionHandler.h"
+#include "../include/Metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
 
 using boost::asio::ip::tcp;
 
@@ -8,8 +12,20 @@ using std::cerr;
 using std::endl;
 using std::string;
 
-ConnectionHandler::ConnectionHandler(string host, short port) : host_(host), port_(port), io_service_(),
-                                                                socket_(io_service_) {}
+static const size_t READ_BUFFER_SIZE = 64 * 1024;       // Initial size, grows for larger frames
+static const size_t SHARED_READ_BUFFER_SIZE = 4 * 1024; // Same, for the many connections of a shared io_service
+
+ConnectionHandler::ConnectionHandler(string host, short port) : host_(host), port_(port),
+                                                                ownedService_(new boost::asio::io_service()),
+                                                                io_service_(*ownedService_), socket_(io_service_),
+                                                                readBuffer_(READ_BUFFER_SIZE), readBegin_(0), readEnd_(0),
+                                                                readScanned_(0), frameArena_(), frameHandler_(),
+                                                                endHandler_() {}
+
+ConnectionHandler::ConnectionHandler(string host, short port, boost::asio::io_service &service) :
+	host_(host), port_(port), ownedService_(), io_service_(service), socket_(io_service_),
+	readBuffer_(SHARED_READ_BUFFER_SIZE), readBegin_(0), readEnd_(0), readScanned_(0), frameArena_(),
+	frameHandler_(), endHandler_() {}
 
 ConnectionHandler::~ConnectionHandler() {
 	close();
@@ -33,7 +49,10 @@ bool ConnectionHandler::connect() {
 }
 
 bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
-	size_t tmp = 0;
+	// Serve bytes already buffered by getFrame first.
+	size_t tmp = std::min(static_cast<size_t>(bytesToRead), readEnd_ - readBegin_);
+	std::memcpy(bytes, readBuffer_.data() + readBegin_, tmp);
+	readBegin_ += tmp;
 	boost::system::error_code error;
 	try {
 		while (!error && bytesToRead > tmp) {
@@ -92,13 +111,103 @@ bool ConnectionHandler::getFrameAscii(std::string &frame, char delimiter) {
 	return true;
 }
 
+bool ConnectionHandler::fillBuffer() {
+	boost::system::error_code error;
+	try {
+		size_t received = socket_.read_some(boost::asio::buffer(readBuffer_.data() + readEnd_, readBuffer_.size() - readEnd_), error);
+		if (error == boost::asio::error::eof)
+			return false; // Orderly close, e.g. after DISCONNECT or shutdown(); the caller reports it if unexpected
+		if (error)
+			throw boost::system::system_error(error);
+		readEnd_ += received;
+	} catch (std::exception &e) {
+		std::cerr << "recv failed (Error: " << e.what() << ')' << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool ConnectionHandler::takeFrame(FrameRef &frame, char delimiter) {
+	const char *start = readBuffer_.data();
+	const void *found = std::memchr(start + readScanned_, delimiter, readEnd_ - readScanned_);
+	if (found == nullptr) {
+		readScanned_ = readEnd_;
+		return false;
+	}
+	size_t end = static_cast<const char *>(found) - start;
+	frame = frameArena_.copy(start + readBegin_, end - readBegin_); // The only copy of the frame
+	Metrics::add(Metrics::FRAMES_RECEIVED);
+	Metrics::add(Metrics::BYTES_RECEIVED, end + 1 - readBegin_);
+	readBegin_ = end + 1;
+	readScanned_ = readBegin_;
+	return true;
+}
+
+void ConnectionHandler::makeRoom() {
+	if (readBegin_ > 0) {
+		std::memmove(readBuffer_.data(), readBuffer_.data() + readBegin_, readEnd_ - readBegin_);
+		readScanned_ -= readBegin_;
+		readEnd_ -= readBegin_;
+		readBegin_ = 0;
+	}
+	if (readEnd_ == readBuffer_.size()) {
+		readBuffer_.resize(readBuffer_.size() * 2);
+	}
+}
+
+bool ConnectionHandler::getFrame(FrameRef &frame, char delimiter) {
+	frame = FrameRef(); // Usually the last reference, which frees the arena block for reuse
+	while (!takeFrame(frame, delimiter)) {
+		makeRoom();
+		if (!fillBuffer()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void ConnectionHandler::readFramesAsync(std::function<bool(const FrameRef &)> onFrame, std::function<void()> onEnd) {
+	frameHandler_ = std::move(onFrame);
+	endHandler_ = std::move(onEnd);
+	continueAsyncRead();
+}
+
+void ConnectionHandler::continueAsyncRead() {
+	FrameRef frame;
+	while (takeFrame(frame, '\0')) {
+		if (!frameHandler_(frame)) {
+			frame = FrameRef();
+			endHandler_();
+			return;
+		}
+		frame = FrameRef(); // Frees the arena block for the next frame
+	}
+	makeRoom();
+	socket_.async_read_some(boost::asio::buffer(readBuffer_.data() + readEnd_, readBuffer_.size() - readEnd_),
+	                        [this](const boost::system::error_code &error, size_t received) {
+		if (error) {
+			endHandler_(); // Closed, or shut down
+			return;
+		}
+		readEnd_ += received;
+		continueAsyncRead();
+	});
+}
+
 bool ConnectionHandler::sendFrameAscii(const std::string &frame, char delimiter) {
 	bool result = sendBytes(frame.c_str(), frame.length());
 	if (!result) return false;
-	return sendBytes(&delimiter, 1);
+	if (!sendBytes(&delimiter, 1)) return false;
+	Metrics::add(Metrics::FRAMES_SENT);
+	Metrics::add(Metrics::BYTES_SENT, frame.length() + 1);
+	return true;
 }
 
 // Close down the connection properly.
+void ConnectionHandler::shutdown() {
+	::shutdown(socket_.native_handle(), SHUT_RDWR); // The socket itself stays open for the reader
+}
+
 void ConnectionHandler::close() {
 	try {
 		socket_.close();
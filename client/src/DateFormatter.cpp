@@ -0,0 +1,147 @@
+#include "../include/DateFormatter.h"
+#include <ctime>
+#include <time.h>
+
+namespace {
+
+const long long SECONDS_PER_DAY = 24 * 3600;
+const long long PROBE_WINDOW = 7 * SECONDS_PER_DAY; // Assumes at most one offset transition per week
+const int OFFSET_SLOTS = 8;                          // Number of cached offset intervals per thread
+
+// Half-open interval [from, to) in which the local UTC offset is constant.
+struct OffsetInterval {
+    long long from;
+    long long to;
+    long offset;
+};
+
+struct OffsetCache {
+    OffsetInterval slots[OFFSET_SLOTS];
+    int used;
+    int next; // Round-robin replacement cursor
+};
+
+// Formatted "dd/mm/yy " prefix of the last local day seen by this thread.
+struct DayCache {
+    long long day;
+    bool valid;
+    char text[9];
+};
+
+thread_local OffsetCache offsetCache = {{}, 0, 0};
+thread_local DayCache dayCache = {0, false, {}};
+
+// Asks the C library for the offset, reading TZ only once per process.
+long probeOffset(long long time) {
+    static const bool tzLoaded = (tzset(), true);
+    (void)tzLoaded;
+    std::time_t t = static_cast<std::time_t>(time);
+    std::tm tm;
+    localtime_r(&t, &tm);
+    return tm.tm_gmtoff;
+}
+
+// Bisects between 'same' (which has the given offset) and 'other' (which does not),
+// returning the instant closest to 'other' that still has the offset.
+long long findTransition(long long same, long long other, long offset) {
+    while (same - other > 1 || other - same > 1) {
+        long long mid = same + (other - same) / 2;
+        if (probeOffset(mid) == offset) {
+            same = mid;
+        } else {
+            other = mid;
+        }
+    }
+    return same;
+}
+
+long long floorDiv(long long a, long long b) {
+    long long q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+void writeTwoDigits(char *out, int value) {
+    out[0] = static_cast<char>('0' + value / 10);
+    out[1] = static_cast<char>('0' + value % 10);
+}
+
+// Converts days since 1970-01-01 to a civil date (proleptic Gregorian calendar).
+void civilFromDays(long long days, long long &year, int &month, int &day) {
+    days += 719468;
+    long long era = (days >= 0 ? days : days - 146096) / 146097;
+    long long dayOfEra = days - era * 146097;
+    long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    long long shiftedMonth = (5 * dayOfYear + 2) / 153;
+    day = static_cast<int>(dayOfYear - (153 * shiftedMonth + 2) / 5 + 1);
+    month = static_cast<int>(shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9);
+    year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+}
+
+} // namespace
+
+long DateFormatter::utcOffset(long long time) {
+    OffsetCache &cache = offsetCache;
+    for (int i = 0; i < cache.used; i++) {
+        const OffsetInterval &slot = cache.slots[i];
+        if (time >= slot.from && time < slot.to) {
+            return slot.offset;
+        }
+    }
+
+    // Miss: probe the offset and the extent of the interval around it.
+    long offset = probeOffset(time);
+    long long from = time - PROBE_WINDOW;
+    if (probeOffset(from) != offset) {
+        from = findTransition(time, from, offset);
+    }
+    long long to = time + PROBE_WINDOW;
+    if (probeOffset(to) != offset) {
+        to = findTransition(time, to, offset) + 1;
+    }
+
+    OffsetInterval &slot = cache.slots[cache.next];
+    slot.from = from;
+    slot.to = to;
+    slot.offset = offset;
+    cache.next = (cache.next + 1) % OFFSET_SLOTS;
+    if (cache.used < OFFSET_SLOTS) {
+        cache.used++;
+    }
+    return offset;
+}
+
+char *DateFormatter::format(int epochTime, char *out) {
+    long long local = static_cast<long long>(epochTime) + utcOffset(epochTime);
+    long long day = floorDiv(local, SECONDS_PER_DAY);
+    long long secondOfDay = local - day * SECONDS_PER_DAY;
+
+    DayCache &cache = dayCache;
+    if (!cache.valid || cache.day != day) {
+        long long year;
+        int month, dayOfMonth;
+        civilFromDays(day, year, month, dayOfMonth);
+        writeTwoDigits(cache.text, dayOfMonth);
+        cache.text[2] = '/';
+        writeTwoDigits(cache.text + 3, month);
+        cache.text[5] = '/';
+        writeTwoDigits(cache.text + 6, static_cast<int>((year % 100 + 100) % 100));
+        cache.text[8] = ' ';
+        cache.day = day;
+        cache.valid = true;
+    }
+
+    for (int i = 0; i < 9; i++) {
+        out[i] = cache.text[i];
+    }
+    writeTwoDigits(out + 9, static_cast<int>(secondOfDay / 3600));
+    out[11] = ':';
+    writeTwoDigits(out + 12, static_cast<int>(secondOfDay / 60 % 60));
+    return out + LENGTH;
+}
+
+std::string DateFormatter::format(int epochTime) {
+    char buffer[LENGTH];
+    format(epochTime, buffer);
+    return std::string(buffer, LENGTH);
+}
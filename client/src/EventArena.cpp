@@ -0,0 +1,72 @@
+#include "../include/EventArena.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<std::size_t> mappedBlocks(0);
+std::atomic<std::size_t> mappedBytes(0);
+
+std::size_t roundUp(std::size_t value, std::size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+} // namespace
+
+const std::size_t EventArena::BLOCK_BYTES;
+const std::size_t EventArena::HUGE_BLOCK_BYTES;
+
+EventArena::EventArena() : current(), used(0), hugePages(false) {}
+
+FrameRef EventArena::mapBlock(std::size_t minimum, bool hugePages) {
+    std::size_t unit = hugePages ? HUGE_BLOCK_BYTES : static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::size_t length = roundUp(std::max(minimum, hugePages ? HUGE_BLOCK_BYTES : BLOCK_BYTES), unit);
+    // Huge pages need a 2 MiB aligned range: map one unit more and trim both ends
+    std::size_t slack = hugePages ? HUGE_BLOCK_BYTES : 0;
+    void *memory = ::mmap(nullptr, length + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    char *data = static_cast<char *>(memory);
+    if (hugePages) {
+        char *aligned = reinterpret_cast<char *>(roundUp(reinterpret_cast<std::uintptr_t>(data), HUGE_BLOCK_BYTES));
+        if (aligned > data) ::munmap(data, static_cast<std::size_t>(aligned - data));
+        std::size_t tail = static_cast<std::size_t>(data + length + slack - (aligned + length));
+        if (tail > 0) ::munmap(aligned + length, tail);
+        data = aligned;
+#ifdef MADV_HUGEPAGE
+        ::madvise(data, length, MADV_HUGEPAGE); // Advisory: THP may be disabled system-wide
+#endif
+    }
+    mappedBlocks++;
+    mappedBytes += length;
+    return FrameRef(FrameBuffer::adopt(data, length, unmapBlock));
+}
+
+void EventArena::unmapBlock(char *data, std::size_t length) {
+    ::munmap(data, length);
+    mappedBlocks--;
+    mappedBytes -= length;
+}
+
+StringRef EventArena::copy(const StringRef &bytes, FrameRef &block) {
+    if (!current || current->size() - used < bytes.size()) {
+        current = mapBlock(bytes.size(), hugePages); // The old block lives on in its events
+        used = 0;
+    }
+    char *target = current->mutableData() + used; // Past every byte already handed out
+    std::memcpy(target, bytes.data(), bytes.size());
+    used += bytes.size();
+    block = current;
+    return StringRef(target, bytes.size());
+}
+
+EventArena::Totals EventArena::totals() {
+    Totals result = {mappedBlocks.load(), mappedBytes.load()};
+    return result;
+}
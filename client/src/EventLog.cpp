@@ -0,0 +1,640 @@
+#include "../include/EventLog.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <iostream>
+#include <unordered_map>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Segment file: 16-byte header, then records of
+//   u32 payload length | u32 checksum of the payload | payload
+// Event payload: u8 type, u8 present bits, u8 value bits, u8 unused, i32 date_time,
+//   u32 lengths of destination, channel, user, city, name and description, u32 overflow count,
+//   the six strings, then per overflow entry u32 key length, u32 value length, key, value.
+// Drop payload: u8 type, u8[3] unused, u32 destination length, destination.
+const char SEGMENT_MAGIC[8] = {'S', 'T', 'O', 'M', 'P', 'L', 'O', 'G'};
+const std::uint32_t SEGMENT_VERSION = 1;
+const std::size_t SEGMENT_HEADER_BYTES = 16;
+const std::size_t RECORD_HEADER_BYTES = 8;
+const std::size_t GROUP_BYTES = std::size_t(1) << 20; // Commits early once this much is pending
+
+const std::uint8_t RECORD_EVENT = 1;
+const std::uint8_t RECORD_DROP = 2;
+
+// Word-at-a-time multiply-xor hash; only has to catch torn or garbled tails.
+std::uint32_t checksum(const char *data, std::size_t length) {
+    std::uint64_t hash = 0x9E3779B97F4A7C15ULL ^ length;
+    std::size_t i = 0;
+    for (; i + 8 <= length; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+    }
+    for (; i < length; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001B3ULL;
+    }
+    hash ^= hash >> 32;
+    return static_cast<std::uint32_t>(hash);
+}
+
+// Serializes one record at the end of a buffer and fills its header on finish().
+class RecordWriter
+{
+public:
+    explicit RecordWriter(std::string &out) : out(out), start(out.size()) {
+        out.append(RECORD_HEADER_BYTES, '\0');
+    }
+
+    void putU8(std::uint8_t value) { out.push_back(static_cast<char>(value)); }
+    void putU32(std::uint32_t value) { out.append(reinterpret_cast<const char *>(&value), 4); }
+    void putBytes(const char *data, std::size_t length) { out.append(data, length); }
+    std::size_t position() const { return out.size(); }
+    void patchU32(std::size_t at, std::uint32_t value) { std::memcpy(&out[at], &value, 4); }
+
+    void finish() {
+        std::uint32_t length = static_cast<std::uint32_t>(out.size() - start - RECORD_HEADER_BYTES);
+        std::uint32_t sum = checksum(out.data() + start + RECORD_HEADER_BYTES, length);
+        std::memcpy(&out[start], &length, 4);
+        std::memcpy(&out[start + 4], &sum, 4);
+    }
+
+private:
+    std::string &out;
+    std::size_t start;
+};
+
+// Bounds-checked reader over one record payload.
+class RecordReader
+{
+public:
+    RecordReader(const char *data, std::size_t length) : cursor(data), end(data + length), ok(true) {}
+
+    std::uint8_t u8() {
+        if (!has(1)) return 0;
+        return static_cast<std::uint8_t>(*cursor++);
+    }
+    std::uint32_t u32() {
+        std::uint32_t value = 0;
+        if (!has(4)) return 0;
+        std::memcpy(&value, cursor, 4);
+        cursor += 4;
+        return value;
+    }
+    const char *bytes(std::size_t length) {
+        if (!has(length)) return nullptr;
+        const char *start = cursor;
+        cursor += length;
+        return start;
+    }
+    void skip(std::size_t length) { bytes(length); }
+    bool good() const { return ok; }
+
+private:
+    const char *cursor;
+    const char *end;
+    bool ok;
+
+    bool has(std::size_t length) {
+        if (ok && static_cast<std::size_t>(end - cursor) >= length) return true;
+        ok = false;
+        return false;
+    }
+};
+
+// A read-only mapping of a whole segment file.
+struct Mapping {
+    char *data;
+    std::size_t size;
+};
+
+bool mapFile(const std::string &path, Mapping &mapping) {
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) return false;
+    struct stat info;
+    if (::fstat(file, &info) != 0 || static_cast<std::size_t>(info.st_size) <= SEGMENT_HEADER_BYTES) {
+        ::close(file);
+        return false;
+    }
+    mapping.size = static_cast<std::size_t>(info.st_size);
+    void *memory = ::mmap(nullptr, mapping.size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (memory == MAP_FAILED) return false;
+    ::madvise(memory, mapping.size, MADV_SEQUENTIAL);
+    mapping.data = static_cast<char *>(memory);
+    if (std::memcmp(mapping.data, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0) {
+        ::munmap(memory, mapping.size);
+        return false;
+    }
+    return true;
+}
+
+void unmapSegment(char *data, std::size_t length) {
+    ::munmap(data, length);
+}
+
+// Calls visit(payload, payloadLength, record, recordLength) for each intact record of a
+// mapped segment, stopping at the first torn or corrupt one.
+template <typename Visitor>
+void forEachRecord(const Mapping &mapping, Visitor visit) {
+    std::size_t position = SEGMENT_HEADER_BYTES;
+    while (position + RECORD_HEADER_BYTES <= mapping.size) {
+        std::uint32_t length;
+        std::uint32_t sum;
+        std::memcpy(&length, mapping.data + position, 4);
+        std::memcpy(&sum, mapping.data + position + 4, 4);
+        if (length == 0 || length > mapping.size - position - RECORD_HEADER_BYTES) break;
+        const char *payload = mapping.data + position + RECORD_HEADER_BYTES;
+        if (checksum(payload, length) != sum) break;
+        visit(payload, length, mapping.data + position, RECORD_HEADER_BYTES + length);
+        position += RECORD_HEADER_BYTES + length;
+    }
+}
+
+bool writeAll(int file, const char *data, std::size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(file, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+void syncDirectory(const std::string &directory) {
+    int file = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (file >= 0) {
+        ::fsync(file);
+        ::close(file);
+    }
+}
+
+bool makeDirectories(const std::string &path) {
+    for (std::size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        std::string prefix = path.substr(0, slash);
+        if (!prefix.empty() && ::mkdir(prefix.c_str(), 0777) != 0 && errno != EEXIST) {
+            return false;
+        }
+        if (slash == std::string::npos) return true;
+    }
+}
+
+// Avoids re-interning a field that repeats the previous record's value. Compares against
+// the interned copy, which outlives the segment mapping the value came from.
+class InternCache
+{
+public:
+    InternCache() : last(nullptr), id(0) {}
+
+    InternId intern(const char *value, std::size_t length) {
+        if (last == nullptr || last->size() != length || std::memcmp(value, last->data(), length) != 0) {
+            id = StringInterner::instance().intern(value, length);
+            last = &StringInterner::instance().lookup(id);
+        }
+        return id;
+    }
+
+private:
+    const std::string *last;
+    InternId id;
+};
+
+} // namespace
+
+const std::size_t EventLog::DEFAULT_SEGMENT_BYTES;
+const std::size_t EventLog::DEFAULT_MAX_BYTES;
+const std::size_t EventLog::MAX_PENDING_BYTES;
+const int EventLog::COMMIT_INTERVAL_MS;
+
+EventLog::EventLog(const std::string &directory, std::size_t segmentBytes, std::size_t maxBytes) :
+    directory(directory),
+    segmentBytes(segmentBytes),
+    maxBytes(maxBytes),
+    mutex(),
+    wake(),
+    drained(),
+    pending(),
+    queuedBytes(0),
+    durableBytes(0),
+    stopping(false),
+    ttl(0),
+    segments(),
+    fd(-1),
+    writer(),
+    appended(0),
+    commits(0),
+    compactions(0) {
+    scanSegments();
+}
+
+EventLog::~EventLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+std::string EventLog::segmentPath(std::uint64_t number) const {
+    char name[40];
+    std::snprintf(name, sizeof(name), "/segment-%010llu.log", static_cast<unsigned long long>(number));
+    return directory + name;
+}
+
+// Lists the existing segments of the directory in order.
+void EventLog::scanSegments() {
+    DIR *dir = ::opendir(directory.c_str());
+    if (dir == nullptr) return;
+    while (struct dirent *entry = ::readdir(dir)) {
+        unsigned long long number;
+        char suffix[8];
+        if (std::sscanf(entry->d_name, "segment-%llu.%7s", &number, suffix) != 2 || std::strcmp(suffix, "log") != 0) {
+            continue;
+        }
+        struct stat info;
+        if (::stat(segmentPath(number).c_str(), &info) == 0) {
+            segments.push_back(Segment{number, static_cast<std::size_t>(info.st_size)});
+        }
+    }
+    ::closedir(dir);
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment &a, const Segment &b) { return a.number < b.number; });
+}
+
+EventLog::ReplayResult EventLog::replay(EventStore &store) {
+    return replay([&store](InternId) -> EventStore & { return store; });
+}
+
+EventLog::ReplayResult EventLog::replay(const EventStoreRouter &storeOf) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    ReplayResult result = {0, 0, 0, 0};
+    StringInterner &interner = StringInterner::instance();
+    InternCache destinationCache, channelCache, userCache, cityCache;
+
+    for (const Segment &segment : segments) {
+        Mapping mapping;
+        if (!mapFile(segmentPath(segment.number), mapping)) continue;
+        // Events keep views into the mapping; it is unmapped when the last of them is evicted.
+        FrameRef frame(FrameBuffer::adopt(mapping.data, mapping.size, unmapSegment));
+        result.segments++;
+        result.bytes += mapping.size;
+
+        forEachRecord(mapping, [&](const char *payload, std::size_t length, const char *, std::size_t) {
+            RecordReader reader(payload, length);
+            std::uint8_t type = reader.u8();
+            if (type == RECORD_DROP) {
+                reader.skip(3);
+                std::uint32_t destinationLength = reader.u32();
+                const char *destination = reader.bytes(destinationLength);
+                if (reader.good()) {
+                    InternId channel = destinationCache.intern(destination, destinationLength);
+                    storeOf(channel).dropChannel(channel);
+                }
+                return;
+            }
+            if (type != RECORD_EVENT) return;
+
+            std::uint8_t present = reader.u8();
+            std::uint8_t values = reader.u8();
+            reader.skip(1);
+            int dateTime = static_cast<int>(reader.u32());
+            std::uint32_t lengths[6];
+            for (std::uint32_t &fieldLength : lengths) {
+                fieldLength = reader.u32();
+            }
+            std::uint32_t overflowCount = reader.u32();
+            const char *fields[6];
+            for (int i = 0; i < 6; i++) {
+                fields[i] = reader.bytes(lengths[i]);
+            }
+            GeneralInformation information(present, values);
+            for (std::uint32_t i = 0; i < overflowCount && reader.good(); i++) {
+                std::uint32_t keyLength = reader.u32();
+                std::uint32_t valueLength = reader.u32();
+                const char *key = reader.bytes(keyLength);
+                const char *value = reader.bytes(valueLength);
+                if (reader.good()) {
+                    information.set(StringRef(key, keyLength), StringRef(value, valueLength));
+                }
+            }
+            if (!reader.good()) return;
+
+            InternId destination = destinationCache.intern(fields[0], lengths[0]);
+            Event event(channelCache.intern(fields[1], lengths[1]),
+                        cityCache.intern(fields[3], lengths[3]),
+                        interner.intern(fields[4], lengths[4]),
+                        dateTime, frame, StringRef(fields[5], lengths[5]), std::move(information),
+                        userCache.intern(fields[2], lengths[2]));
+            storeOf(destination).add(destination, std::move(event));
+            result.events++;
+        });
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+bool EventLog::open() {
+    if (!makeDirectories(directory)) {
+        std::cerr << "Could not create event log directory " << directory << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    while (!segments.empty() && segments.back().bytes <= SEGMENT_HEADER_BYTES) {
+        ::unlink(segmentPath(segments.back().number).c_str()); // Left by a session that received nothing
+        segments.pop_back();
+    }
+    std::uint64_t next = segments.empty() ? 0 : segments.back().number + 1;
+    if (!startSegment(next)) {
+        return false;
+    }
+    writer = std::thread(&EventLog::run, this);
+    return true;
+}
+
+// Creates a new segment with its header and makes it the active one.
+bool EventLog::startSegment(std::uint64_t number) {
+    std::string path = segmentPath(number);
+    int file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0666);
+    if (file < 0) {
+        std::cerr << "Could not create event log segment " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    char header[SEGMENT_HEADER_BYTES] = {0};
+    std::memcpy(header, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    std::memcpy(header + sizeof(SEGMENT_MAGIC), &SEGMENT_VERSION, 4);
+    if (!writeAll(file, header, sizeof(header)) || ::fsync(file) != 0) {
+        std::cerr << "Could not write event log segment " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(file);
+        return false;
+    }
+    syncDirectory(directory);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    fd = file;
+    segments.push_back(Segment{number, sizeof(header)});
+    return true;
+}
+
+void EventLog::append(InternId channel, const Event &event) {
+    const std::string &destination = StringInterner::instance().lookup(channel);
+    const std::string &channelName = event.get_channel_name();
+    const std::string &user = event.getEventOwnerUser();
+    const std::string &city = event.get_city();
+    const std::string &name = event.get_name();
+    StringRef description = event.get_description();
+    const GeneralInformation &information = event.get_general_information();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (pending.size() >= MAX_PENDING_BYTES && !stopping) {
+        drained.wait(lock); // The disk fell behind, hold the receiver back
+    }
+    std::size_t before = pending.size();
+    RecordWriter record(pending);
+    record.putU8(RECORD_EVENT);
+    record.putU8(information.presentBits());
+    record.putU8(information.valueBits());
+    record.putU8(0);
+    record.putU32(static_cast<std::uint32_t>(event.get_date_time()));
+    record.putU32(static_cast<std::uint32_t>(destination.size()));
+    record.putU32(static_cast<std::uint32_t>(channelName.size()));
+    record.putU32(static_cast<std::uint32_t>(user.size()));
+    record.putU32(static_cast<std::uint32_t>(city.size()));
+    record.putU32(static_cast<std::uint32_t>(name.size()));
+    record.putU32(static_cast<std::uint32_t>(description.size()));
+    std::size_t countAt = record.position();
+    record.putU32(0);
+    record.putBytes(destination.data(), destination.size());
+    record.putBytes(channelName.data(), channelName.size());
+    record.putBytes(user.data(), user.size());
+    record.putBytes(city.data(), city.size());
+    record.putBytes(name.data(), name.size());
+    record.putBytes(description.data(), description.size());
+    std::uint32_t overflowCount = 0;
+    information.forEachOverflow([&](const std::string &key, const std::string &value) {
+        record.putU32(static_cast<std::uint32_t>(key.size()));
+        record.putU32(static_cast<std::uint32_t>(value.size()));
+        record.putBytes(key.data(), key.size());
+        record.putBytes(value.data(), value.size());
+        overflowCount++;
+    });
+    record.patchU32(countAt, overflowCount);
+    record.finish();
+    queuedBytes += pending.size() - before;
+    appended++;
+    if (pending.size() >= GROUP_BYTES) {
+        wake.notify_one();
+    }
+}
+
+void EventLog::appendDrop(InternId channel) {
+    const std::string &destination = StringInterner::instance().lookup(channel);
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t before = pending.size();
+    RecordWriter record(pending);
+    record.putU8(RECORD_DROP);
+    record.putU8(0);
+    record.putU8(0);
+    record.putU8(0);
+    record.putU32(static_cast<std::uint32_t>(destination.size()));
+    record.putBytes(destination.data(), destination.size());
+    record.finish();
+    queuedBytes += pending.size() - before;
+    appended++;
+}
+
+void EventLog::setTtl(long long seconds) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ttl = seconds > 0 ? seconds : 0;
+}
+
+void EventLog::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    std::uint64_t target = queuedBytes;
+    wake.notify_one();
+    drained.wait(lock, [this, target]() { return durableBytes >= target || fd < 0; });
+}
+
+EventLog::Status EventLog::status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Status result = {segments.size(), 0, appended, commits, compactions};
+    for (const Segment &segment : segments) {
+        result.diskBytes += segment.bytes;
+    }
+    return result;
+}
+
+// Writes whatever was appended during the last interval as one group and fsyncs it once.
+void EventLog::run() {
+    std::string batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait_for(lock, std::chrono::milliseconds(COMMIT_INTERVAL_MS),
+                      [this]() { return stopping || pending.size() >= GROUP_BYTES; });
+        if (pending.empty()) {
+            if (stopping) break;
+            continue;
+        }
+        batch.swap(pending); // The old batch's capacity is reused by the next appends
+        lock.unlock();
+
+        bool written = writeAll(fd, batch.data(), batch.size()) && ::fdatasync(fd) == 0;
+        if (!written) {
+            std::cerr << "Could not write event log: " << std::strerror(errno) << std::endl;
+        }
+
+        lock.lock();
+        durableBytes += batch.size();
+        if (written) {
+            segments.back().bytes += batch.size();
+        }
+        commits++;
+        batch.clear();
+        drained.notify_all();
+
+        if (segments.back().bytes >= segmentBytes) {
+            lock.unlock();
+            roll();
+            lock.lock();
+        }
+    }
+}
+
+void EventLog::roll() {
+    int sealed = fd;
+    if (!startSegment(segments.back().number + 1)) {
+        return; // Keep appending to the current segment
+    }
+    ::close(sealed);
+
+    std::size_t total = 0;
+    for (const Segment &segment : segments) {
+        total += segment.bytes;
+    }
+    if (total > maxBytes) {
+        compact();
+    }
+}
+
+// Merges all sealed segments into one, keeping at most half of the disk limit. Only the
+// writer thread changes the segment list, so sealed segments can be read without the lock.
+void EventLog::compact() {
+    struct Record {
+        const char *data;
+        std::size_t size;
+        std::uint8_t type;
+        std::string destination;
+        int dateTime;
+    };
+
+    if (segments.size() < 2) return;
+    std::vector<Segment> sealed(segments.begin(), segments.end() - 1);
+    std::vector<Mapping> mappings;
+    std::vector<Record> records;
+    long long watermark = 0;
+    for (const Segment &segment : sealed) {
+        Mapping mapping;
+        if (!mapFile(segmentPath(segment.number), mapping)) continue;
+        mappings.push_back(mapping);
+        forEachRecord(mapping, [&](const char *payload, std::size_t length, const char *data, std::size_t size) {
+            RecordReader reader(payload, length);
+            Record record = {data, size, reader.u8(), std::string(), 0};
+            reader.skip(3);
+            if (record.type == RECORD_EVENT) {
+                record.dateTime = static_cast<int>(reader.u32());
+                std::uint32_t destinationLength = reader.u32();
+                reader.skip(4 * 6);
+                const char *destination = reader.bytes(destinationLength);
+                if (reader.good()) record.destination.assign(destination, destinationLength);
+                watermark = std::max<long long>(watermark, record.dateTime);
+            } else {
+                std::uint32_t destinationLength = reader.u32();
+                const char *destination = reader.bytes(destinationLength);
+                if (reader.good()) record.destination.assign(destination, destinationLength);
+            }
+            if (reader.good()) records.push_back(record);
+        });
+    }
+
+    long long expiry;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        expiry = ttl;
+    }
+
+    // A channel's events before its last drop are gone from the store, and so are expired ones.
+    std::unordered_map<std::string, std::size_t> lastDrop;
+    for (std::size_t i = 0; i < records.size(); i++) {
+        if (records[i].type == RECORD_DROP) lastDrop[records[i].destination] = i;
+    }
+    std::vector<const Record *> kept;
+    std::size_t keptBytes = 0;
+    for (std::size_t i = 0; i < records.size(); i++) {
+        const Record &record = records[i];
+        if (record.type != RECORD_EVENT) continue;
+        std::unordered_map<std::string, std::size_t>::const_iterator drop = lastDrop.find(record.destination);
+        if (drop != lastDrop.end() && drop->second > i) continue;
+        if (expiry > 0 && record.dateTime + expiry <= watermark) continue;
+        kept.push_back(&record);
+        keptBytes += record.size;
+    }
+    std::size_t first = 0;
+    while (first < kept.size() && SEGMENT_HEADER_BYTES + keptBytes > maxBytes / 2) {
+        keptBytes -= kept[first++]->size; // Still too large: the oldest records go
+    }
+
+    // Write the survivors under the newest sealed number so replay order is preserved.
+    std::uint64_t number = sealed.back().number;
+    std::string target = segmentPath(number);
+    std::string temporary = target + ".tmp";
+    int file = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    bool written = file >= 0;
+    if (written) {
+        char header[SEGMENT_HEADER_BYTES] = {0};
+        std::memcpy(header, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+        std::memcpy(header + sizeof(SEGMENT_MAGIC), &SEGMENT_VERSION, 4);
+        std::string buffer(header, sizeof(header));
+        for (std::size_t i = first; i < kept.size() && written; i++) {
+            buffer.append(kept[i]->data, kept[i]->size);
+            if (buffer.size() >= GROUP_BYTES) {
+                written = writeAll(file, buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+        written = written && writeAll(file, buffer.data(), buffer.size()) && ::fsync(file) == 0;
+        ::close(file);
+    }
+    for (const Mapping &mapping : mappings) {
+        ::munmap(mapping.data, mapping.size);
+    }
+    if (!written || ::rename(temporary.c_str(), target.c_str()) != 0) {
+        std::cerr << "Could not compact event log: " << std::strerror(errno) << std::endl;
+        ::unlink(temporary.c_str());
+        return;
+    }
+    for (std::size_t i = 0; i + 1 < sealed.size(); i++) {
+        ::unlink(segmentPath(sealed[i].number).c_str()); // Mappings held by replayed events stay valid
+    }
+    syncDirectory(directory);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    segments.erase(segments.begin(), segments.begin() + (sealed.size() - 1));
+    segments.front().bytes = SEGMENT_HEADER_BYTES + keptBytes;
+    compactions++;
+}
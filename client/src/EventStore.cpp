@@ -0,0 +1,334 @@
+#include "../include/EventStore.h"
+#include <algorithm>
+
+const std::size_t EventStore::COLUMN_ROW_BYTES;
+const std::size_t EventStore::MIN_TAIL_MERGE;
+const std::size_t EventStore::WHEEL_SLOTS;
+const long long EventStore::WHEEL_SLOTS_PER_TTL;
+
+EventStore::EventStore() :
+    channels(),
+    sketches(),
+    rollups(),
+    bucketWidth(RollupTable::DEFAULT_WIDTH),
+    wheel(WHEEL_SLOTS, 1),
+    watermark(0),
+    hasWatermark(false),
+    nextChannelSeq(0),
+    removalClock(0),
+    userVersions(),
+    budget(0),
+    ttl(0),
+    freeOnExit(false),
+    useArena(true),
+    hugePages(false),
+    totalBytes(0),
+    totalEvents(0),
+    evictedByBudget(0),
+    evictedByTtl(0),
+    evictedByUnsubscribe(0) {}
+
+void EventStore::add(InternId channelId, Event &&event) {
+    std::unordered_map<InternId, Channel>::iterator it = channels.find(channelId);
+    if (it == channels.end()) {
+        it = channels.insert(std::make_pair(channelId, Channel())).first;
+        it->second.firstSeq = nextChannelSeq; // Never reuse sequence numbers of a dropped channel
+        it->second.lastRemoval = ++removalClock;
+        it->second.arena.setHugePages(hugePages);
+    }
+    Channel &channel = it->second;
+    if (useArena && !event.hasExternalStorage()) {
+        // Keep only the description, packed with the channel's others; the frame is freed here
+        FrameRef block;
+        StringRef description = event.get_description();
+        StringRef copy = description.empty() ? StringRef() : channel.arena.copy(description, block);
+        event.moveDescription(block, copy);
+    }
+    userVersions[(std::uint64_t(channelId) << 32) | event.getEventOwnerUserId()]++;
+    sketches[channelId].add(event.getEventOwnerUserId(), event.get_city_id());
+    addToRollup(channelId, event);
+    long long time = event.get_date_time();
+    std::uint32_t bytes = static_cast<std::uint32_t>(sizeof(StoredEvent) + COLUMN_ROW_BYTES + event.memoryUsage());
+
+    channel.dateTime.push_back(event.get_date_time());
+    channel.city.push_back(event.get_city_id());
+    channel.user.push_back(event.getEventOwnerUserId());
+    channel.name.push_back(event.get_name_id());
+    channel.present.push_back(event.get_general_information().presentBits());
+    channel.values.push_back(event.get_general_information().valueBits());
+    channel.live.push_back(1);
+    std::uint64_t seq = channel.firstSeq + channel.events.size();
+    std::size_t indexBefore = channel.text.memoryUsage();
+    channel.text.add(seq, event.get_description());
+    channel.text.add(seq, StringRef(event.get_name()));
+    channel.text.add(seq, StringRef(event.get_city()));
+    bytes += static_cast<std::uint32_t>(channel.text.memoryUsage() - indexBefore); // Postings added for this event
+
+    channel.events.push_back(StoredEvent{std::move(event), bytes, true});
+    indexTime(channel, static_cast<int>(time), seq);
+    channel.bytes += bytes;
+    channel.liveCount++;
+    totalBytes += bytes;
+    totalEvents++;
+
+    if (ttl > 0) {
+        if (!hasWatermark || time > watermark) {
+            watermark = time;
+            hasWatermark = true;
+            wheel.advance(watermark, [this](const TimerWheel::Entry &entry) { expire(entry); });
+        }
+        if (time + ttl <= watermark) {
+            evict(channel, channel.events.size() - 1); // Arrived already expired
+            evictedByTtl++;
+        } else {
+            wheel.schedule(TimerWheel::Entry{time + ttl, channelId, seq});
+        }
+    } else if (!hasWatermark || time > watermark) {
+        watermark = time;
+        hasWatermark = true;
+    }
+
+    enforceBudget();
+}
+
+bool EventStore::hasChannel(InternId channel) const {
+    return channels.find(channel) != channels.end();
+}
+
+void EventStore::addToRollup(InternId channelId, const Event &event) {
+    std::unordered_map<InternId, RollupTable>::iterator it = rollups.find(channelId);
+    if (it == rollups.end()) {
+        it = rollups.insert(std::make_pair(channelId, RollupTable(bucketWidth))).first;
+    }
+    const GeneralInformation &info = event.get_general_information();
+    it->second.add(event.get_date_time(), event.get_city_id(),
+                   info.has(GeneralInformation::ACTIVE) && info.isTrue(GeneralInformation::ACTIVE),
+                   info.has(GeneralInformation::FORCES_ARRIVAL_AT_SCENE) && info.isTrue(GeneralInformation::FORCES_ARRIVAL_AT_SCENE));
+}
+
+std::uint64_t EventStore::userVersion(InternId channel, InternId user) const {
+    std::unordered_map<std::uint64_t, std::uint64_t>::const_iterator it = userVersions.find((std::uint64_t(channel) << 32) | user);
+    return it == userVersions.end() ? 0 : it->second;
+}
+
+std::uint64_t EventStore::removalVersion(InternId channel) const {
+    std::unordered_map<InternId, Channel>::const_iterator it = channels.find(channel);
+    return it == channels.end() ? UINT64_MAX : it->second.lastRemoval; // A dropped channel differs from any live one
+}
+
+std::uint64_t EventStore::endSeq(InternId channel) const {
+    std::unordered_map<InternId, Channel>::const_iterator it = channels.find(channel);
+    return it == channels.end() ? nextChannelSeq : it->second.firstSeq + it->second.events.size();
+}
+
+const RollupTable *EventStore::rollup(InternId channel) const {
+    std::unordered_map<InternId, RollupTable>::const_iterator it = rollups.find(channel);
+    return it == rollups.end() ? nullptr : &it->second;
+}
+
+const ChannelSketch *EventStore::sketch(InternId channel) const {
+    std::unordered_map<InternId, ChannelSketch>::const_iterator it = sketches.find(channel);
+    return it == sketches.end() ? nullptr : &it->second;
+}
+
+void EventStore::indexTime(Channel &channel, int dateTime, std::uint64_t seq) {
+    // In-order arrivals extend the sorted run; the rest wait in the tail.
+    if (channel.timeTail.empty() && (channel.timeRun.empty() || channel.timeRun.back().dateTime <= dateTime)) {
+        channel.timeRun.push_back(TimeEntry{dateTime, seq});
+        return;
+    }
+    channel.timeTail.push_back(TimeEntry{dateTime, seq});
+    channel.tailSorted = false;
+    if (channel.timeTail.size() > MIN_TAIL_MERGE && channel.timeTail.size() > channel.timeRun.size() / 8) {
+        mergeTail(channel);
+    }
+}
+
+void EventStore::mergeTail(Channel &channel) {
+    std::vector<TimeEntry> tail;
+    tail.swap(channel.timeTail);
+    std::sort(tail.begin(), tail.end(), [](const TimeEntry &a, const TimeEntry &b) { return a.dateTime < b.dateTime; });
+
+    std::vector<TimeEntry> merged;
+    merged.reserve(channel.liveCount);
+    std::vector<TimeEntry>::const_iterator run = channel.timeRun.begin(), next = tail.begin();
+    while (run != channel.timeRun.end() || next != tail.end()) {
+        // Stable: equal times keep run entries (older) first
+        bool fromRun = next == tail.end() || (run != channel.timeRun.end() && run->dateTime <= next->dateTime);
+        const TimeEntry &entry = fromRun ? *run++ : *next++;
+        if (isLive(channel, entry.seq)) {
+            merged.push_back(entry);
+        }
+    }
+    channel.timeRun.swap(merged);
+    channel.tailSorted = true;
+}
+
+bool EventStore::isLive(const Channel &channel, std::uint64_t seq) {
+    return seq >= channel.firstSeq && seq - channel.firstSeq < channel.events.size() &&
+           channel.events[static_cast<std::size_t>(seq - channel.firstSeq)].live;
+}
+
+void EventStore::rowsInRange(InternId channelId, long long from, long long to, std::vector<std::uint32_t> &rows) const {
+    std::unordered_map<InternId, Channel>::const_iterator it = channels.find(channelId);
+    if (it == channels.end()) return;
+    forEachIndexInRange(it->second, from, to, [&rows](std::size_t index) {
+        rows.push_back(static_cast<std::uint32_t>(index));
+    });
+}
+
+bool EventStore::columns(InternId channelId, ColumnView &view) const {
+    std::unordered_map<InternId, Channel>::const_iterator it = channels.find(channelId);
+    if (it == channels.end() || it->second.events.empty()) return false;
+    const Channel &channel = it->second;
+    std::size_t base = channel.columnBase;
+    view = ColumnView{channel.events.size(), &channel.dateTime[base], &channel.city[base], &channel.user[base],
+                      &channel.name[base], &channel.present[base], &channel.values[base], &channel.live[base]};
+    return true;
+}
+
+void EventStore::evict(Channel &channel, std::size_t index) {
+    StoredEvent &stored = channel.events[index];
+    if (!stored.live) return;
+    stored.live = false;
+    channel.live[channel.columnBase + index] = 0;
+    channel.lastRemoval = ++removalClock;
+    stored.event.releaseStorage();
+    channel.bytes -= stored.bytes;
+    totalBytes -= stored.bytes;
+    stored.bytes = 0;
+    channel.liveCount--;
+    totalEvents--;
+}
+
+void EventStore::trimFront(Channel &channel) {
+    while (!channel.events.empty() && !channel.events.front().live) {
+        channel.events.pop_front();
+        channel.firstSeq++;
+        channel.columnBase++;
+    }
+    // Erase trimmed column rows once they are at least half of the arrays.
+    if (channel.columnBase >= 1024 && channel.columnBase * 2 >= channel.dateTime.size()) {
+        std::size_t base = channel.columnBase;
+        channel.dateTime.erase(channel.dateTime.begin(), channel.dateTime.begin() + base);
+        channel.city.erase(channel.city.begin(), channel.city.begin() + base);
+        channel.user.erase(channel.user.begin(), channel.user.begin() + base);
+        channel.name.erase(channel.name.begin(), channel.name.begin() + base);
+        channel.present.erase(channel.present.begin(), channel.present.begin() + base);
+        channel.values.erase(channel.values.begin(), channel.values.begin() + base);
+        channel.live.erase(channel.live.begin(), channel.live.begin() + base);
+        channel.columnBase = 0;
+        mergeTail(channel); // Also drops index entries of the trimmed events
+        channel.text.prune(channel.firstSeq);
+    }
+}
+
+void EventStore::enforceBudget() {
+    while (budget > 0 && totalBytes > budget && totalEvents > 0) {
+        // Oldest-first within the channel that holds the most bytes.
+        Channel *largest = nullptr;
+        for (std::unordered_map<InternId, Channel>::iterator it = channels.begin(); it != channels.end(); ++it) {
+            if (it->second.liveCount > 0 && (largest == nullptr || it->second.bytes > largest->bytes)) {
+                largest = &it->second;
+            }
+        }
+        trimFront(*largest);
+        evict(*largest, 0);
+        evictedByBudget++;
+        trimFront(*largest);
+    }
+}
+
+void EventStore::expire(const TimerWheel::Entry &entry) {
+    std::unordered_map<InternId, Channel>::iterator it = channels.find(entry.channel);
+    if (it == channels.end()) return;
+    Channel &channel = it->second;
+    if (entry.seq < channel.firstSeq || entry.seq >= channel.firstSeq + channel.events.size()) return;
+
+    std::size_t index = static_cast<std::size_t>(entry.seq - channel.firstSeq);
+    if (channel.events[index].live) {
+        evict(channel, index);
+        evictedByTtl++;
+    }
+    trimFront(channel);
+}
+
+void EventStore::dropChannel(InternId channelId) {
+    std::unordered_map<InternId, Channel>::iterator it = channels.find(channelId);
+    if (it == channels.end()) return;
+    nextChannelSeq = std::max<std::uint64_t>(nextChannelSeq, it->second.firstSeq + it->second.events.size());
+    evictedByUnsubscribe += it->second.liveCount;
+    totalBytes -= it->second.bytes;
+    totalEvents -= it->second.liveCount;
+    channels.erase(it); // Pending wheel entries of the channel are ignored when they fire
+}
+
+void EventStore::setBudget(std::size_t bytes) {
+    budget = bytes;
+    enforceBudget();
+}
+
+void EventStore::setTtl(long long seconds) {
+    ttl = seconds > 0 ? seconds : 0;
+    rescheduleAll();
+}
+
+void EventStore::setFreeOnUnsubscribe(bool enabled) {
+    freeOnExit = enabled;
+}
+
+void EventStore::setArena(bool enabled, bool huge) {
+    useArena = enabled;
+    hugePages = huge;
+    for (std::unordered_map<InternId, Channel>::iterator it = channels.begin(); it != channels.end(); ++it) {
+        it->second.arena.setHugePages(huge);
+    }
+}
+
+void EventStore::setRollupWidth(long long seconds) {
+    if (seconds <= 0 || seconds == bucketWidth) return;
+    bucketWidth = seconds;
+    rollups.clear(); // Buckets cannot be split, so recount what is still stored
+    for (std::unordered_map<InternId, Channel>::const_iterator it = channels.begin(); it != channels.end(); ++it) {
+        for (const StoredEvent &stored : it->second.events) {
+            if (stored.live) addToRollup(it->first, stored.event);
+        }
+    }
+}
+
+void EventStore::rescheduleAll() {
+    long long granularity = ttl / WHEEL_SLOTS_PER_TTL;
+    wheel.reset(granularity > 0 ? granularity : 1);
+    if (ttl == 0 || !hasWatermark) return;
+
+    wheel.advance(watermark, [](const TimerWheel::Entry &) {});
+    for (std::unordered_map<InternId, Channel>::iterator it = channels.begin(); it != channels.end(); ++it) {
+        Channel &channel = it->second;
+        for (std::size_t i = 0; i < channel.events.size(); i++) {
+            StoredEvent &stored = channel.events[i];
+            if (!stored.live) continue;
+            long long expiry = stored.event.get_date_time() + ttl;
+            if (expiry <= watermark) {
+                evict(channel, i);
+                evictedByTtl++;
+            } else {
+                wheel.schedule(TimerWheel::Entry{expiry, it->first, channel.firstSeq + i});
+            }
+        }
+        trimFront(channel);
+    }
+}
+
+EventStore::Usage EventStore::usage() const {
+    Usage result = {totalBytes, totalEvents, budget, ttl, freeOnExit, evictedByBudget, evictedByTtl, evictedByUnsubscribe};
+    return result;
+}
+
+std::vector<EventStore::ChannelUsage> EventStore::channelUsage() const {
+    std::vector<ChannelUsage> result;
+    for (std::unordered_map<InternId, Channel>::const_iterator it = channels.begin(); it != channels.end(); ++it) {
+        ChannelUsage channel = {it->first, it->second.liveCount, it->second.bytes};
+        result.push_back(channel);
+    }
+    return result;
+}
@@ -0,0 +1,79 @@
+#include "../include/FrameArena.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace {
+
+constexpr std::size_t alignUp(std::size_t value) {
+    return (value + 15) / 16 * 16;
+}
+
+} // namespace
+
+const std::size_t FrameArena::BLOCK_ROUNDING;
+const std::size_t FrameArena::RING_SIZE;
+const std::size_t FrameArena::HEADER_OFFSET = alignUp(sizeof(FrameArena::Block));
+const std::size_t FrameArena::BYTES_OFFSET = FrameArena::HEADER_OFFSET + alignUp(sizeof(FrameBuffer));
+
+FrameArena::FrameArena() : ring(), current(0), frames(0), blocks(0) {}
+
+FrameArena::~FrameArena() {
+    for (Block *block : ring) {
+        if (block == nullptr) continue;
+        int expected = IN_USE;
+        if (!block->state.compare_exchange_strong(expected, DETACHED, std::memory_order_acq_rel)) {
+            freeBlock(block);
+        }
+    }
+}
+
+FrameRef FrameArena::copy(const char *data, std::size_t length) {
+    // The latest block is reused if its frame is gone already, otherwise the ring moves on.
+    Block *block = ring[current];
+    if (block != nullptr && block->state.load(std::memory_order_acquire) != FREE) {
+        current = (current + 1) % RING_SIZE;
+        block = ring[current];
+        int expected = IN_USE;
+        if (block != nullptr && block->state.compare_exchange_strong(expected, DETACHED, std::memory_order_acq_rel)) {
+            block = nullptr; // That frame is still referenced and now owns its block
+        }
+    }
+    std::size_t needed = BYTES_OFFSET + length + 1;
+    if (block != nullptr && block->capacity < needed) {
+        freeBlock(block);
+        block = nullptr;
+    }
+    if (block == nullptr) {
+        std::size_t capacity = (needed + BLOCK_ROUNDING - 1) / BLOCK_ROUNDING * BLOCK_ROUNDING;
+        void *memory = std::malloc(capacity);
+        if (memory == nullptr) {
+            ring[current] = nullptr;
+            throw std::bad_alloc();
+        }
+        block = new (memory) Block();
+        block->capacity = capacity;
+        blocks++;
+    }
+    ring[current] = block;
+    block->state.store(IN_USE, std::memory_order_relaxed);
+    frames++;
+
+    char *base = reinterpret_cast<char *>(block);
+    char *bytes = base + BYTES_OFFSET;
+    std::memcpy(bytes, data, length);
+    return FrameRef(FrameBuffer::place(base + HEADER_OFFSET, bytes, length, releaseFrame));
+}
+
+void FrameArena::freeBlock(Block *block) {
+    block->~Block();
+    std::free(block);
+}
+
+void FrameArena::releaseFrame(char *data, std::size_t) {
+    Block *block = reinterpret_cast<Block *>(data - BYTES_OFFSET);
+    int expected = IN_USE;
+    if (!block->state.compare_exchange_strong(expected, FREE, std::memory_order_acq_rel)) {
+        freeBlock(block); // Detached: the arena moved on, the block is the frame's to free
+    }
+}
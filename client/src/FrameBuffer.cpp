@@ -0,0 +1,51 @@
+#include "../include/FrameBuffer.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+FrameBuffer *FrameBuffer::allocate(std::size_t length) {
+    void *memory = std::malloc(sizeof(FrameBuffer) + length + 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    char *inlineBytes = static_cast<char *>(memory) + sizeof(FrameBuffer);
+    FrameBuffer *buffer = new (memory) FrameBuffer(length, inlineBytes, nullptr, false);
+    inlineBytes[length] = '\0';
+    return buffer;
+}
+
+FrameBuffer *FrameBuffer::adopt(char *data, std::size_t length, ReleaseFunction release) {
+    void *memory = std::malloc(sizeof(FrameBuffer));
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return new (memory) FrameBuffer(length, data, release, false);
+}
+
+FrameBuffer *FrameBuffer::place(void *memory, char *data, std::size_t length, ReleaseFunction release) {
+    data[length] = '\0';
+    return new (memory) FrameBuffer(length, data, release, true);
+}
+
+FrameBuffer *FrameBuffer::create(const char *data, std::size_t length) {
+    FrameBuffer *buffer = allocate(length);
+    std::memcpy(buffer->bytes(), data, length);
+    return buffer;
+}
+
+void FrameBuffer::release() {
+    if (references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // A placed header may live in the storage release_ reclaims, so it goes first
+        ReleaseFunction releaseStorage = release_;
+        char *data = storage;
+        std::size_t bytes = length;
+        bool own = !placed;
+        this->~FrameBuffer();
+        if (own) {
+            std::free(this);
+        }
+        if (releaseStorage != nullptr) {
+            releaseStorage(data, bytes);
+        }
+    }
+}
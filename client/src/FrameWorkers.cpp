@@ -0,0 +1,64 @@
+#include "../include/FrameWorkers.h"
+
+const std::size_t FrameWorkers::QUEUE_CAPACITY;
+
+FrameWorkers::FrameWorkers(std::size_t count, Handler handler) : handler(std::move(handler)), workers() {
+    for (std::size_t i = 0; i < count; i++) {
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        workers[i]->thread = std::thread(&FrameWorkers::run, this, i);
+    }
+}
+
+FrameWorkers::~FrameWorkers() {
+    for (std::unique_ptr<Worker> &worker : workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->stopping = true;
+        worker->ready.notify_one();
+    }
+    for (std::unique_ptr<Worker> &worker : workers) {
+        worker->thread.join();
+    }
+}
+
+void FrameWorkers::dispatch(std::size_t index, const FrameRef &frame) {
+    Worker &worker = *workers[index];
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    worker.space.wait(lock, [&worker]() { return worker.queue.size() < QUEUE_CAPACITY; });
+    worker.queue.push_back(frame);
+    worker.dispatched++;
+    if (worker.queue.size() == 1) {
+        worker.ready.notify_one(); // The worker only waits on an empty queue
+    }
+}
+
+void FrameWorkers::drain() {
+    for (std::unique_ptr<Worker> &worker : workers) {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        Worker &waited = *worker;
+        std::uint64_t target = waited.dispatched; // Frames dispatched while waiting are not waited for
+        waited.space.wait(lock, [&waited, target]() { return waited.handled >= target; });
+    }
+}
+
+void FrameWorkers::run(std::size_t index) {
+    Worker &worker = *workers[index];
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    while (true) {
+        worker.ready.wait(lock, [&worker]() { return !worker.queue.empty() || worker.stopping; });
+        if (worker.queue.empty()) {
+            return; // Stopping, and everything queued was handled
+        }
+        FrameRef frame = std::move(worker.queue.front());
+        worker.queue.pop_front();
+        lock.unlock();
+
+        handler(index, frame);
+        frame = FrameRef(); // Released before the next wait, so its arena block can be reused
+
+        lock.lock();
+        worker.handled++;
+        worker.space.notify_all();
+    }
+}
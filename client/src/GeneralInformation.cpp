@@ -0,0 +1,119 @@
+#include "../include/GeneralInformation.h"
+#include <algorithm>
+
+GeneralInformation::GeneralInformation() : present(0), values(0), overflow() {}
+
+GeneralInformation::GeneralInformation(const std::map<std::string, std::string> &entries) :
+    present(0), values(0), overflow() {
+    for (std::map<std::string, std::string>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        set(it->first, it->second);
+    }
+}
+
+GeneralInformation::GeneralInformation(std::uint8_t presentBits, std::uint8_t valueBits) :
+    present(presentBits), values(valueBits & presentBits), overflow() {}
+
+GeneralInformation::GeneralInformation(const GeneralInformation &other) :
+    present(other.present),
+    values(other.values),
+    overflow(other.overflow ? new Overflow(*other.overflow) : nullptr) {}
+
+GeneralInformation::GeneralInformation(GeneralInformation &&other) :
+    present(other.present),
+    values(other.values),
+    overflow(std::move(other.overflow)) {}
+
+GeneralInformation &GeneralInformation::operator=(GeneralInformation &&other) {
+    present = other.present;
+    values = other.values;
+    overflow = std::move(other.overflow);
+    return *this;
+}
+
+GeneralInformation &GeneralInformation::operator=(const GeneralInformation &other) {
+    if (this != &other) {
+        present = other.present;
+        values = other.values;
+        overflow.reset(other.overflow ? new Overflow(*other.overflow) : nullptr);
+    }
+    return *this;
+}
+
+const char *GeneralInformation::keyName(Key key) {
+    return key == ACTIVE ? "active" : "forces_arrival_at_scene";
+}
+
+bool GeneralInformation::knownKey(const StringRef &key, Key &known) {
+    for (int candidate = 0; candidate < KNOWN_KEY_COUNT; candidate++) {
+        if (key == StringRef(keyName(static_cast<Key>(candidate)))) {
+            known = static_cast<Key>(candidate);
+            return true;
+        }
+    }
+    return false;
+}
+
+void GeneralInformation::eraseOverflow(const std::string &key) {
+    if (!overflow) return;
+    for (Overflow::iterator it = overflow->begin(); it != overflow->end(); ++it) {
+        if (it->first == key) {
+            overflow->erase(it);
+            break;
+        }
+    }
+    if (overflow->empty()) {
+        overflow.reset();
+    }
+}
+
+void GeneralInformation::set(const StringRef &key, const StringRef &value) {
+    Key known;
+    bool isTrue = value == StringRef("true");
+    if (knownKey(key, known) && (isTrue || value == StringRef("false"))) {
+        if (overflow) {
+            eraseOverflow(key.str());
+        }
+        present |= static_cast<std::uint8_t>(1u << known);
+        if (isTrue) {
+            values |= static_cast<std::uint8_t>(1u << known);
+        } else {
+            values &= static_cast<std::uint8_t>(~(1u << known));
+        }
+        return;
+    }
+
+    // Anything else is kept verbatim, sorted by key like the map it replaces.
+    if (knownKey(key, known)) {
+        present &= static_cast<std::uint8_t>(~(1u << known));
+        values &= static_cast<std::uint8_t>(~(1u << known));
+    }
+    if (!overflow) {
+        overflow.reset(new Overflow());
+    }
+    std::string keyText = key.str();
+    Overflow::iterator it = std::lower_bound(overflow->begin(), overflow->end(), keyText,
+        [](const std::pair<std::string, std::string> &entry, const std::string &k) { return entry.first < k; });
+    if (it != overflow->end() && it->first == keyText) {
+        it->second = value.str();
+    } else {
+        overflow->insert(it, std::make_pair(keyText, value.str()));
+    }
+}
+
+std::size_t GeneralInformation::size() const {
+    std::size_t count = overflow ? overflow->size() : 0;
+    for (int key = 0; key < KNOWN_KEY_COUNT; key++) {
+        count += (present >> key) & 1;
+    }
+    return count;
+}
+
+std::size_t GeneralInformation::memoryUsage() const {
+    if (!overflow) return 0;
+    std::size_t bytes = sizeof(Overflow) + overflow->capacity() * sizeof(Overflow::value_type);
+    for (const Overflow::value_type &entry : *overflow) {
+        bytes += entry.first.capacity() > 15 ? entry.first.capacity() + 1 : 0;
+        bytes += entry.second.capacity() > 15 ? entry.second.capacity() + 1 : 0;
+    }
+    return bytes;
+}
@@ -0,0 +1,73 @@
+#include "../include/LatencyHistogram.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+const unsigned LatencyHistogram::SUB_BITS;
+
+namespace {
+const std::uint64_t SUB_COUNT = std::uint64_t(1) << LatencyHistogram::SUB_BITS;
+}
+
+LatencyHistogram::LatencyHistogram() :
+    counts((64 - SUB_BITS + 1) * SUB_COUNT, 0), total(0), negativeCount(0), minimum(0), maximum(0), sum(0) {}
+
+std::size_t LatencyHistogram::bucketOf(std::uint64_t value) {
+    if (value < SUB_COUNT) {
+        return static_cast<std::size_t>(value); // Group 0: exact
+    }
+    unsigned exponent = 63 - __builtin_clzll(value);
+    std::uint64_t group = exponent - SUB_BITS + 1;
+    std::uint64_t offset = (value >> (exponent - SUB_BITS)) - SUB_COUNT;
+    return static_cast<std::size_t>(group * SUB_COUNT + offset);
+}
+
+std::uint64_t LatencyHistogram::highestIn(std::size_t bucket) {
+    std::uint64_t group = bucket / SUB_COUNT;
+    std::uint64_t offset = bucket % SUB_COUNT;
+    if (group == 0) {
+        return offset;
+    }
+    std::uint64_t width = std::uint64_t(1) << (group - 1);
+    return (SUB_COUNT + offset) * width + width - 1;
+}
+
+void LatencyHistogram::record(long long nanoseconds) {
+    if (nanoseconds < 0) {
+        negativeCount++;
+        nanoseconds = 0;
+    }
+    counts[bucketOf(static_cast<std::uint64_t>(nanoseconds))]++;
+    minimum = total ? std::min(minimum, nanoseconds) : nanoseconds;
+    maximum = std::max(maximum, nanoseconds);
+    sum += nanoseconds;
+    total++;
+}
+
+void LatencyHistogram::reset() {
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    negativeCount = 0;
+    minimum = 0;
+    maximum = 0;
+    sum = 0;
+}
+
+long long LatencyHistogram::percentile(double fraction) const {
+    if (total == 0) return 0;
+    std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(fraction * total));
+    rank = std::max<std::uint64_t>(rank, 1);
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < counts.size(); bucket++) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return static_cast<long long>(std::min<std::uint64_t>(highestIn(bucket), maximum));
+        }
+    }
+    return maximum;
+}
+
+long long LatencyHistogram::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,235 @@
+#include "../include/Metrics.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+const std::size_t Metrics::BUCKETS;
+
+namespace {
+
+// One thread's metrics; only that thread writes them.
+struct Slot {
+    std::atomic<std::uint64_t> counters[Metrics::COUNTER_COUNT];
+    std::atomic<std::uint64_t> buckets[Metrics::HISTOGRAM_COUNT][Metrics::BUCKETS];
+    std::atomic<std::uint64_t> sums[Metrics::HISTOGRAM_COUNT];
+
+    Slot();
+    ~Slot();
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<Slot *> live;
+    Metrics::Totals retired; // Sums of the slots of exited threads
+
+    Registry() : mutex(), live(), retired() {}
+};
+
+// Never destroyed: threads may still exit (and retire their slot) during static destruction
+Registry &registry() {
+    static Registry *instance = new Registry();
+    return *instance;
+}
+
+Slot::Slot() {
+    for (std::atomic<std::uint64_t> &counter : counters) counter.store(0, std::memory_order_relaxed);
+    for (std::atomic<std::uint64_t> (&histogram)[Metrics::BUCKETS] : buckets) {
+        for (std::atomic<std::uint64_t> &bucket : histogram) bucket.store(0, std::memory_order_relaxed);
+    }
+    for (std::atomic<std::uint64_t> &sum : sums) sum.store(0, std::memory_order_relaxed);
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.live.push_back(this);
+}
+
+Slot::~Slot() {
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    for (std::size_t i = 0; i < Metrics::COUNTER_COUNT; i++) {
+        shared.retired.counters[i] += counters[i].load(std::memory_order_relaxed);
+    }
+    for (std::size_t h = 0; h < Metrics::HISTOGRAM_COUNT; h++) {
+        for (std::size_t b = 0; b < Metrics::BUCKETS; b++) {
+            shared.retired.buckets[h][b] += buckets[h][b].load(std::memory_order_relaxed);
+        }
+        shared.retired.sums[h] += sums[h].load(std::memory_order_relaxed);
+    }
+    for (std::size_t i = 0; i < shared.live.size(); i++) {
+        if (shared.live[i] == this) {
+            shared.live[i] = shared.live.back();
+            shared.live.pop_back();
+            break;
+        }
+    }
+}
+
+Slot &localSlot() {
+    thread_local Slot slot;
+    return slot;
+}
+
+// Single writer: a relaxed load and store instead of a locked read-modify-write
+inline void bump(std::atomic<std::uint64_t> &value, std::uint64_t amount) {
+    value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+const char *COUNTER_NAMES[Metrics::COUNTER_COUNT] = {
+    "frames_received_total", "received_bytes_total", "frames_sent_total", "sent_bytes_total",
+    "events_stored_total", "receipts_total",
+    "reader_queued_total", "reader_taken_total", "worker_queued_total", "worker_done_total"};
+const char *COUNTER_HELP[Metrics::COUNTER_COUNT] = {
+    "Frames read from the server.", "Bytes of frames read from the server.", "Frames written to the server.",
+    "Bytes of frames written to the server.", "MESSAGE events stored.", "RECEIPT frames matched to a request.",
+    "Frames pushed to the reader ring.", "Frames popped from the reader ring.",
+    "MESSAGE frames dispatched to workers.", "MESSAGE frames stored by workers."};
+const char *HISTOGRAM_NAMES[Metrics::HISTOGRAM_COUNT] = {
+    "frame_processing_seconds", "send_seconds", "receipt_latency_seconds"};
+const char *HISTOGRAM_HELP[Metrics::HISTOGRAM_COUNT] = {
+    "Time to parse and handle one received frame.", "Time to frame and write one frame.",
+    "Time from sending a request to handling its RECEIPT."};
+
+// Frames between two counters; the counters of different threads may be read slightly apart.
+std::uint64_t depth(std::uint64_t queued, std::uint64_t taken) {
+    return queued > taken ? queued - taken : 0;
+}
+
+// Upper bound (ns) of the bucket holding the given rank, 0 if empty.
+double percentile(const std::uint64_t (&buckets)[Metrics::BUCKETS], std::uint64_t count, double fraction) {
+    std::uint64_t rank = static_cast<std::uint64_t>(fraction * count) + 1;
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < Metrics::BUCKETS; b++) {
+        seen += buckets[b];
+        if (seen >= rank) return static_cast<double>(std::uint64_t(1) << b);
+    }
+    return 0;
+}
+
+} // namespace
+
+void Metrics::add(Counter counter, std::uint64_t amount) {
+    bump(localSlot().counters[counter], amount);
+}
+
+void Metrics::observe(Histogram histogram, std::uint64_t nanoseconds) {
+    std::size_t bucket = nanoseconds == 0 ? 0 : 64 - __builtin_clzll(nanoseconds); // nanoseconds < 2^bucket
+    Slot &slot = localSlot();
+    bump(slot.buckets[histogram][bucket < BUCKETS ? bucket : BUCKETS - 1], 1);
+    bump(slot.sums[histogram], nanoseconds);
+}
+
+std::uint64_t Metrics::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Metrics::Totals Metrics::read() {
+    Registry &shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    Totals totals = shared.retired;
+    for (const Slot *slot : shared.live) {
+        for (std::size_t i = 0; i < COUNTER_COUNT; i++) {
+            totals.counters[i] += slot->counters[i].load(std::memory_order_relaxed);
+        }
+        for (std::size_t h = 0; h < HISTOGRAM_COUNT; h++) {
+            for (std::size_t b = 0; b < BUCKETS; b++) {
+                totals.buckets[h][b] += slot->buckets[h][b].load(std::memory_order_relaxed);
+            }
+            totals.sums[h] += slot->sums[h].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+void Metrics::print(std::ostream &out) {
+    Totals totals = read();
+    const std::uint64_t *c = totals.counters;
+    std::ostringstream text;
+    text << "Frames received: " << c[FRAMES_RECEIVED] << " (" << c[BYTES_RECEIVED] << " bytes)\n"
+         << "Frames sent: " << c[FRAMES_SENT] << " (" << c[BYTES_SENT] << " bytes)\n"
+         << "Events stored: " << c[EVENTS_STORED] << ", receipts: " << c[RECEIPTS] << "\n"
+         << "Queued frames: reader ring " << depth(c[READER_QUEUED], c[READER_TAKEN]) << ", workers "
+         << depth(c[WORKER_QUEUED], c[WORKER_DONE]) << "\n";
+    text << std::fixed << std::setprecision(1);
+    const char *LABELS[HISTOGRAM_COUNT] = {"Frame processing", "Send", "Receipt latency"};
+    for (std::size_t h = 0; h < HISTOGRAM_COUNT; h++) {
+        std::uint64_t count = 0;
+        for (std::uint64_t bucket : totals.buckets[h]) count += bucket;
+        text << LABELS[h] << " us: " << count << " timed";
+        if (count > 0) {
+            text << ", mean " << totals.sums[h] / 1e3 / count << ", p50 < " << percentile(totals.buckets[h], count, 0.5) / 1e3
+                 << ", p99 < " << percentile(totals.buckets[h], count, 0.99) / 1e3;
+        }
+        text << "\n";
+    }
+    out << text.str() << std::flush;
+}
+
+void Metrics::writePrometheus(std::ostream &out) {
+    Totals totals = read();
+    std::ostringstream text;
+    for (std::size_t i = 0; i < COUNTER_COUNT; i++) {
+        text << "# HELP stomp_client_" << COUNTER_NAMES[i] << ' ' << COUNTER_HELP[i] << '\n'
+             << "# TYPE stomp_client_" << COUNTER_NAMES[i] << " counter\n"
+             << "stomp_client_" << COUNTER_NAMES[i] << ' ' << totals.counters[i] << '\n';
+    }
+    text << "# HELP stomp_client_reader_queue_depth Frames waiting in the reader ring.\n"
+         << "# TYPE stomp_client_reader_queue_depth gauge\n"
+         << "stomp_client_reader_queue_depth " << depth(totals.counters[READER_QUEUED], totals.counters[READER_TAKEN]) << '\n'
+         << "# HELP stomp_client_worker_queue_depth MESSAGE frames waiting for a worker.\n"
+         << "# TYPE stomp_client_worker_queue_depth gauge\n"
+         << "stomp_client_worker_queue_depth " << depth(totals.counters[WORKER_QUEUED], totals.counters[WORKER_DONE]) << '\n';
+    for (std::size_t h = 0; h < HISTOGRAM_COUNT; h++) {
+        text << "# HELP stomp_client_" << HISTOGRAM_NAMES[h] << ' ' << HISTOGRAM_HELP[h] << '\n'
+             << "# TYPE stomp_client_" << HISTOGRAM_NAMES[h] << " histogram\n";
+        std::uint64_t cumulative = 0;
+        for (std::size_t b = 0; b + 1 < BUCKETS; b++) {
+            cumulative += totals.buckets[h][b];
+            char bound[32];
+            std::snprintf(bound, sizeof(bound), "%g", static_cast<double>(std::uint64_t(1) << b) / 1e9);
+            text << "stomp_client_" << HISTOGRAM_NAMES[h] << "_bucket{le=\"" << bound << "\"} " << cumulative << '\n';
+        }
+        cumulative += totals.buckets[h][BUCKETS - 1];
+        char sum[32];
+        std::snprintf(sum, sizeof(sum), "%llu.%09llu", static_cast<unsigned long long>(totals.sums[h] / 1000000000),
+                      static_cast<unsigned long long>(totals.sums[h] % 1000000000)); // Exact, whatever the size
+        text << "stomp_client_" << HISTOGRAM_NAMES[h] << "_bucket{le=\"+Inf\"} " << cumulative << '\n'
+             << "stomp_client_" << HISTOGRAM_NAMES[h] << "_sum " << sum << '\n'
+             << "stomp_client_" << HISTOGRAM_NAMES[h] << "_count " << cumulative << '\n';
+    }
+    out << text.str();
+}
+
+bool Metrics::dumpPrometheus(const std::string &path) {
+    std::string temporary = path + ".tmp"; // Scrapers never see a partial file
+    std::ofstream out(temporary.c_str());
+    writePrometheus(out);
+    out.close();
+    return out && std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+MetricsDumper::MetricsDumper(const std::string &path, long long intervalMs) :
+    path(path), intervalMs(intervalMs), stopping(false), mutex(), wake(), thread() {
+    thread = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, std::chrono::milliseconds(this->intervalMs), [this]() { return stopping; })) {
+            if (!Metrics::dumpPrometheus(this->path)) {
+                std::cerr << "Could not write metrics to " << this->path << std::endl;
+            }
+        }
+    });
+}
+
+MetricsDumper::~MetricsDumper() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        wake.notify_all();
+    }
+    thread.join();
+    Metrics::dumpPrometheus(path); // The final values
+}
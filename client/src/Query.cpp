@@ -0,0 +1,304 @@
+#include "../include/Query.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <unordered_map>
+
+namespace {
+
+// Splits on spaces; a double-quoted token may contain spaces.
+std::vector<std::string> tokenize(const std::string &text) {
+    std::vector<std::string> tokens;
+    std::size_t i = 0;
+    while (i < text.size()) {
+        if (text[i] == ' ') {
+            i++;
+        } else if (text[i] == '"') {
+            std::size_t end = text.find('"', i + 1);
+            if (end == std::string::npos) end = text.size();
+            tokens.push_back(text.substr(i + 1, end - i - 1));
+            i = end + 1;
+        } else {
+            std::size_t end = text.find(' ', i);
+            if (end == std::string::npos) end = text.size();
+            tokens.push_back(text.substr(i, end - i));
+            i = end;
+        }
+    }
+    return tokens;
+}
+
+Query::Field parseField(const std::string &name) {
+    static const char *NAMES[] = {"city", "user", "name", "date_time", "active", "forces_arrival_at_scene"};
+    for (int field = Query::CITY; field < Query::NO_FIELD; field++) {
+        if (name == NAMES[field]) return static_cast<Query::Field>(field);
+    }
+    return Query::NO_FIELD;
+}
+
+bool parseOp(const std::string &text, Query::Op &op) {
+    static const char *OPS[] = {"=", "!=", "<", "<=", ">", ">="};
+    for (int i = Query::EQUAL; i <= Query::GREATER_EQUAL; i++) {
+        if (text == OPS[i]) {
+            op = static_cast<Query::Op>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// mask[i] &= keep(column[i]), written without branches so the compiler can vectorize it.
+template <typename T, typename Keep>
+void narrow(const T *column, std::size_t count, std::uint8_t *mask, Keep keep) {
+    for (std::size_t i = 0; i < count; i++) {
+        mask[i] &= static_cast<std::uint8_t>(keep(column[i]));
+    }
+}
+
+void narrowDate(const int *column, std::size_t count, std::uint8_t *mask, Query::Op op, long long bound) {
+    switch (op) {
+        case Query::EQUAL:         narrow(column, count, mask, [bound](int v) { return v == bound; }); break;
+        case Query::NOT_EQUAL:     narrow(column, count, mask, [bound](int v) { return v != bound; }); break;
+        case Query::LESS:          narrow(column, count, mask, [bound](int v) { return v < bound; }); break;
+        case Query::LESS_EQUAL:    narrow(column, count, mask, [bound](int v) { return v <= bound; }); break;
+        case Query::GREATER:       narrow(column, count, mask, [bound](int v) { return v > bound; }); break;
+        case Query::GREATER_EQUAL: narrow(column, count, mask, [bound](int v) { return v >= bound; }); break;
+    }
+}
+
+} // namespace
+
+const std::size_t Query::BLOCK_ROWS;
+
+bool Query::takeRange(std::vector<std::string> &tokens, long long &from, long long &to, std::string &error) {
+    std::vector<std::string> rest;
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        if (tokens[i] != "--from" && tokens[i] != "--to") {
+            rest.push_back(tokens[i]);
+            continue;
+        }
+        char *end = nullptr;
+        long long value = i + 1 < tokens.size() ? std::strtoll(tokens[i + 1].c_str(), &end, 10) : 0;
+        if (i + 1 >= tokens.size() || tokens[i + 1].empty() || *end != '\0') {
+            error = tokens[i] + " needs an epoch number";
+            return false;
+        }
+        (tokens[i] == "--from" ? from : to) = value;
+        i++;
+    }
+    tokens.swap(rest);
+    return true;
+}
+
+Query::Query() : channel(), predicates(), groupBy(NO_FIELD), hasRange(false), from(0), to(0) {}
+
+const char *Query::fieldName(Field field) {
+    static const char *NAMES[] = {"city", "user", "name", "date_time", "active", "forces_arrival_at_scene", ""};
+    return NAMES[field];
+}
+
+bool Query::parse(const std::string &text, Query &query, std::string &error) {
+    std::vector<std::string> tokens = tokenize(text);
+    query = Query();
+
+    // --from/--to may appear anywhere; take them out before parsing the clauses.
+    long long from = LLONG_MIN, to = LLONG_MAX;
+    if (!takeRange(tokens, from, to, error)) {
+        return false;
+    }
+    if (from != LLONG_MIN || to != LLONG_MAX) {
+        query.hasRange = true;
+        query.from = from;
+        query.to = to;
+    }
+    if (tokens.empty()) {
+        error = "missing channel";
+        return false;
+    }
+    query.channel = tokens[0];
+    std::size_t i = 1;
+
+    if (i < tokens.size() && tokens[i] == "where") {
+        do {
+            i++;
+            if (i + 3 > tokens.size()) {
+                error = "incomplete predicate";
+                return false;
+            }
+            Predicate predicate = {parseField(tokens[i]), EQUAL, 0, 0, false, false};
+            const std::string &value = tokens[i + 2];
+            if (predicate.field == NO_FIELD) {
+                error = "unknown field " + tokens[i];
+                return false;
+            }
+            if (!parseOp(tokens[i + 1], predicate.op)) {
+                error = "unknown operator " + tokens[i + 1];
+                return false;
+            }
+            if (predicate.field == DATE_TIME) {
+                char *end = nullptr;
+                predicate.number = std::strtoll(value.c_str(), &end, 10);
+                if (value.empty() || *end != '\0') {
+                    error = "date_time needs an epoch number: " + value;
+                    return false;
+                }
+            } else if (predicate.op != EQUAL && predicate.op != NOT_EQUAL) {
+                error = std::string(fieldName(predicate.field)) + " only supports = and !=";
+                return false;
+            } else if (predicate.field == ACTIVE || predicate.field == FORCES_ARRIVAL_AT_SCENE) {
+                if (value != "true" && value != "false") {
+                    error = std::string(fieldName(predicate.field)) + " needs true or false";
+                    return false;
+                }
+                predicate.flag = value == "true";
+            } else {
+                predicate.known = StringInterner::instance().find(value, predicate.id);
+            }
+            query.predicates.push_back(predicate);
+            i += 3;
+        } while (i < tokens.size() && tokens[i] == "and");
+    }
+
+    if (i < tokens.size() && tokens[i] == "group") {
+        if (i + 3 != tokens.size() || tokens[i + 1] != "by") {
+            error = "expected group by {field}";
+            return false;
+        }
+        query.groupBy = parseField(tokens[i + 2]);
+        if (query.groupBy == NO_FIELD || query.groupBy == DATE_TIME) {
+            error = "cannot group by " + tokens[i + 2];
+            return false;
+        }
+        i += 3;
+    }
+
+    if (i != tokens.size()) {
+        error = "unexpected " + tokens[i];
+        return false;
+    }
+    return true;
+}
+
+Query::Result Query::run(const EventStore &store) const {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Result result = {0, 0, std::vector<std::pair<std::string, std::size_t>>(), 0};
+
+    InternId channelId;
+    EventStore::ColumnView view;
+    if (!StringInterner::instance().find(channel, channelId) || !store.columns(channelId, view)) {
+        return result;
+    }
+
+    // A time window selects rows through the store's time index; they are gathered into
+    // contiguous block buffers so the same loops run over them.
+    std::vector<std::uint32_t> rows;
+    if (hasRange) {
+        store.rowsInRange(channelId, from, to, rows);
+    }
+    std::size_t total = hasRange ? rows.size() : view.rows;
+    int dateTime[BLOCK_ROWS];
+    InternId city[BLOCK_ROWS], user[BLOCK_ROWS], name[BLOCK_ROWS];
+    std::uint8_t present[BLOCK_ROWS], values[BLOCK_ROWS], live[BLOCK_ROWS];
+
+    std::uint8_t mask[BLOCK_ROWS];
+    std::unordered_map<InternId, std::size_t> idCounts;
+    std::size_t flagCounts[3] = {0, 0, 0}; // Absent, false, true
+
+    for (std::size_t begin = 0; begin < total; begin += BLOCK_ROWS) {
+        std::size_t count = std::min(BLOCK_ROWS, total - begin);
+        EventStore::ColumnView block;
+        if (!hasRange) {
+            block = EventStore::ColumnView{count, view.dateTime + begin, view.city + begin, view.user + begin,
+                                           view.name + begin, view.present + begin, view.values + begin, view.live + begin};
+        } else {
+            for (std::size_t i = 0; i < count; i++) {
+                std::uint32_t row = rows[begin + i];
+                dateTime[i] = view.dateTime[row];
+                city[i] = view.city[row];
+                user[i] = view.user[row];
+                name[i] = view.name[row];
+                present[i] = view.present[row];
+                values[i] = view.values[row];
+                live[i] = view.live[row];
+            }
+            block = EventStore::ColumnView{count, dateTime, city, user, name, present, values, live};
+        }
+        std::copy(block.live, block.live + count, mask);
+
+        for (const Predicate &predicate : predicates) {
+            switch (predicate.field) {
+                case DATE_TIME:
+                    narrowDate(block.dateTime, count, mask, predicate.op, predicate.number);
+                    break;
+                case CITY:
+                case USER:
+                case NAME: {
+                    const InternId *column = predicate.field == CITY ? block.city
+                                           : predicate.field == USER ? block.user : block.name;
+                    InternId id = predicate.id;
+                    if (!predicate.known) {
+                        if (predicate.op == EQUAL) std::fill(mask, mask + count, 0);
+                    } else if (predicate.op == EQUAL) {
+                        narrow(column, count, mask, [id](InternId v) { return v == id; });
+                    } else {
+                        narrow(column, count, mask, [id](InternId v) { return v != id; });
+                    }
+                    break;
+                }
+                case ACTIVE:
+                case FORCES_ARRIVAL_AT_SCENE: {
+                    std::uint8_t bit = static_cast<std::uint8_t>(1u << (predicate.field == ACTIVE
+                        ? GeneralInformation::ACTIVE : GeneralInformation::FORCES_ARRIVAL_AT_SCENE));
+                    // Value bits are a subset of present bits: true = value bit, false = present without it.
+                    std::uint8_t expect = predicate.op == EQUAL ? 1 : 0;
+                    std::uint8_t valueMask = predicate.flag ? 0 : 0xFF; // Inverts the value bit for false
+                    for (std::size_t i = 0; i < count; i++) {
+                        std::uint8_t matches = (block.present[i] & (block.values[i] ^ valueMask) & bit) != 0;
+                        mask[i] &= static_cast<std::uint8_t>(matches == expect);
+                    }
+                    break;
+                }
+                case NO_FIELD:
+                    break;
+            }
+        }
+
+        std::size_t matched = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            matched += mask[i];
+        }
+        result.matched += matched;
+        result.scanned += count;
+        if (groupBy == NO_FIELD || matched == 0) continue;
+
+        if (groupBy == ACTIVE || groupBy == FORCES_ARRIVAL_AT_SCENE) {
+            std::uint8_t bit = static_cast<std::uint8_t>(1u << (groupBy == ACTIVE
+                ? GeneralInformation::ACTIVE : GeneralInformation::FORCES_ARRIVAL_AT_SCENE));
+            for (std::size_t i = 0; i < count; i++) {
+                std::size_t bucket = (block.present[i] & bit) == 0 ? 0 : (block.values[i] & bit) == 0 ? 1 : 2;
+                flagCounts[bucket] += mask[i];
+            }
+        } else {
+            const InternId *column = groupBy == CITY ? block.city : groupBy == USER ? block.user : block.name;
+            for (std::size_t i = 0; i < count; i++) {
+                if (mask[i]) idCounts[column[i]]++;
+            }
+        }
+    }
+
+    if (groupBy == ACTIVE || groupBy == FORCES_ARRIVAL_AT_SCENE) {
+        static const char *LABELS[] = {"(none)", "false", "true"};
+        for (int bucket = 0; bucket < 3; bucket++) {
+            if (flagCounts[bucket] > 0) result.groups.push_back(std::make_pair(std::string(LABELS[bucket]), flagCounts[bucket]));
+        }
+    } else {
+        for (std::unordered_map<InternId, std::size_t>::const_iterator it = idCounts.begin(); it != idCounts.end(); ++it) {
+            result.groups.push_back(std::make_pair(StringInterner::instance().lookup(it->first), it->second));
+        }
+    }
+    std::sort(result.groups.begin(), result.groups.end());
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
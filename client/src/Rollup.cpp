@@ -0,0 +1,23 @@
+#include "../include/Rollup.h"
+
+const long long RollupTable::DEFAULT_WIDTH;
+
+RollupTable::RollupTable(long long width) : bucketWidth(width > 0 ? width : DEFAULT_WIDTH), cells() {}
+
+long long RollupTable::bucketStart(long long dateTime) const {
+    long long bucket = dateTime / bucketWidth;
+    if (dateTime % bucketWidth < 0) bucket--; // Floor for times before the epoch
+    return bucket * bucketWidth;
+}
+
+void RollupTable::add(long long dateTime, InternId city, bool active, bool forcesArrival) {
+    std::pair<long long, InternId> key(bucketStart(dateTime), city);
+    std::map<std::pair<long long, InternId>, Counts>::iterator it = cells.lower_bound(key);
+    if (it == cells.end() || it->first != key) {
+        it = cells.insert(it, std::make_pair(key, Counts{0, 0, 0})); // Only new cells allocate a node
+    }
+    Counts &counts = it->second;
+    counts.total++;
+    counts.active += active;
+    counts.forcesArrival += forcesArrival;
+}
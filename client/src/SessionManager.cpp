@@ -0,0 +1,114 @@
+#include "../include/SessionManager.h"
+#include <algorithm>
+#include <iostream>
+
+SessionManager::SessionManager(std::size_t ioThreads) :
+    service(), work(), threads(), threadCount(std::max<std::size_t>(ioThreads, 1)), sessions(), mutex(), stopped() {}
+
+SessionManager::~SessionManager() {
+    for (std::pair<const std::string, std::unique_ptr<Session>> &entry : sessions) {
+        entry.second->protocol->signalStopCommunication(); // Not a lost connection
+        entry.second->connection->shutdown();              // Ends the pending reads
+    }
+    work.reset();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    sessions.clear();
+}
+
+void SessionManager::startThreads() {
+    work.reset(new boost::asio::io_service::work(service));
+    for (std::size_t i = 0; i < threadCount; i++) {
+        threads.push_back(std::thread([this]() { service.run(); }));
+    }
+}
+
+SessionManager::Session *SessionManager::open(const std::string &name, const std::string &host, short port,
+                                              const std::string &username,
+                                              const std::function<void(StompProtocol &)> &setup) {
+    reapFinished();
+    std::unique_ptr<Session> session(new Session());
+    session->name = name;
+    session->username = username;
+    session->connection.reset(new ConnectionHandler(host, port, service));
+    session->protocol.reset(new StompProtocol(*session->connection)); // Frames are parsed on the I/O thread
+    setup(*session->protocol);
+    if (!session->connection->connect()) {
+        return nullptr;
+    }
+    if (threads.empty()) {
+        startThreads();
+    }
+
+    Session *opened = session.get();
+    sessions[name] = std::move(session);
+    StompProtocol *protocol = opened->protocol.get();
+    opened->connection->readFramesAsync(
+        [protocol](const FrameRef &frame) {
+            protocol->parseFrame(frame);
+            return !protocol->shouldStopCommunication();
+        },
+        [this, opened, protocol]() {
+            if (!protocol->shouldStopCommunication()) {
+                std::cerr << "Server connection lost (session " << opened->name << ")." << std::endl;
+                protocol->signalStopCommunication();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            opened->finished = true; // The command thread may free the session from here on
+            stopped.notify_all();
+        });
+    return opened;
+}
+
+SessionManager::Session *SessionManager::find(const std::string &name) {
+    reapFinished();
+    std::map<std::string, std::unique_ptr<Session>>::iterator it = sessions.find(name);
+    return it == sessions.end() ? nullptr : it->second.get();
+}
+
+void SessionManager::waitFinished(Session &session) {
+    std::unique_lock<std::mutex> lock(mutex);
+    stopped.wait(lock, [&session]() { return session.finished; });
+}
+
+void SessionManager::remove(const std::string &name) {
+    std::map<std::string, std::unique_ptr<Session>>::iterator it = sessions.find(name);
+    if (it == sessions.end()) return;
+    {
+        // A session still reading is shut down first; its end handler runs on an I/O thread
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!it->second->finished) {
+            it->second->protocol->signalStopCommunication();
+            it->second->connection->shutdown();
+            Session &session = *it->second;
+            stopped.wait(lock, [&session]() { return session.finished; });
+        }
+    }
+    it->second->connection->close();
+    sessions.erase(it);
+}
+
+void SessionManager::reapFinished() {
+    std::vector<std::string> finished;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::pair<const std::string, std::unique_ptr<Session>> &entry : sessions) {
+            if (entry.second->finished) {
+                finished.push_back(entry.first);
+            }
+        }
+    }
+    for (const std::string &name : finished) {
+        remove(name);
+    }
+}
+
+void SessionManager::print() {
+    reapFinished();
+    std::cout << sessions.size() << " sessions on " << threads.size() << " I/O threads" << std::endl;
+    for (std::pair<const std::string, std::unique_ptr<Session>> &entry : sessions) {
+        std::cout << "  " << entry.first << ": " << entry.second->username << ", "
+                  << (entry.second->protocol->isConnected() ? "connected" : "connecting") << std::endl;
+    }
+}
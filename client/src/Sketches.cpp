@@ -0,0 +1,111 @@
+#include "../include/Sketches.h"
+#include <algorithm>
+#include <cmath>
+
+const unsigned HyperLogLog::PRECISION;
+const std::size_t CountMinSketch::DEPTH;
+const std::size_t CountMinSketch::WIDTH;
+const std::size_t TopK::K;
+
+HyperLogLog::HyperLogLog() : registers(std::size_t(1) << PRECISION, 0) {}
+
+void HyperLogLog::add(std::uint64_t hash) {
+    std::size_t index = static_cast<std::size_t>(hash >> (64 - PRECISION));
+    std::uint64_t rest = (hash << PRECISION) | (std::uint64_t(1) << (PRECISION - 1)); // Bounds the rank
+    std::uint8_t rank = static_cast<std::uint8_t>(__builtin_clzll(rest) + 1);
+    if (rank > registers[index]) {
+        registers[index] = rank;
+    }
+}
+
+double HyperLogLog::estimate() const {
+    const double m = static_cast<double>(registers.size());
+    double sum = 0;
+    std::size_t zeros = 0;
+    for (std::uint8_t value : registers) {
+        sum += std::ldexp(1.0, -value);
+        zeros += value == 0;
+    }
+    double raw = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+    if (raw <= 2.5 * m && zeros > 0) {
+        return m * std::log(m / static_cast<double>(zeros)); // Linear counting for small sets
+    }
+    return raw;
+}
+
+double HyperLogLog::relativeError() {
+    return 1.04 / std::sqrt(static_cast<double>(std::size_t(1) << PRECISION));
+}
+
+CountMinSketch::CountMinSketch() : counters(DEPTH * WIDTH, 0) {}
+
+std::uint32_t CountMinSketch::add(std::uint64_t hash) {
+    std::uint32_t smallest = UINT32_MAX;
+    for (std::size_t row = 0; row < DEPTH; row++) {
+        // Row hashes from disjoint bit ranges of one 64-bit hash (WIDTH is 2^10)
+        std::size_t column = static_cast<std::size_t>((hash >> (row * 16)) % WIDTH);
+        std::uint32_t &counter = counters[row * WIDTH + column];
+        if (counter < UINT32_MAX) counter++;
+        smallest = std::min(smallest, counter);
+    }
+    return smallest;
+}
+
+std::uint32_t CountMinSketch::estimate(std::uint64_t hash) const {
+    std::uint32_t smallest = UINT32_MAX;
+    for (std::size_t row = 0; row < DEPTH; row++) {
+        std::size_t column = static_cast<std::size_t>((hash >> (row * 16)) % WIDTH);
+        smallest = std::min(smallest, counters[row * WIDTH + column]);
+    }
+    return smallest;
+}
+
+TopK::TopK() : heap() {}
+
+void TopK::offer(InternId item, std::uint32_t count) {
+    typedef std::pair<std::uint32_t, InternId> Entry;
+    std::greater<Entry> minOnTop;
+    for (Entry &entry : heap) {
+        if (entry.second == item) {
+            entry.first = count; // Estimates only grow, restore the heap order below it
+            std::make_heap(heap.begin(), heap.end(), minOnTop);
+            return;
+        }
+    }
+    if (heap.size() < K) {
+        heap.push_back(Entry(count, item));
+        std::push_heap(heap.begin(), heap.end(), minOnTop);
+    } else if (count > heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end(), minOnTop);
+        heap.back() = Entry(count, item);
+        std::push_heap(heap.begin(), heap.end(), minOnTop);
+    }
+}
+
+std::vector<std::pair<InternId, std::uint32_t>> TopK::items() const {
+    std::vector<std::pair<std::uint32_t, InternId>> sorted(heap);
+    std::sort(sorted.begin(), sorted.end(), std::greater<std::pair<std::uint32_t, InternId>>());
+    std::vector<std::pair<InternId, std::uint32_t>> result;
+    for (const std::pair<std::uint32_t, InternId> &entry : sorted) {
+        result.push_back(std::make_pair(entry.second, entry.first));
+    }
+    return result;
+}
+
+ChannelSketch::ChannelSketch() : count(0), users(), cities(), cityCounts(), cityTop() {}
+
+std::uint64_t ChannelSketch::hash(InternId id) {
+    // splitmix64 finalizer: interned IDs are small consecutive integers
+    std::uint64_t x = id + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+void ChannelSketch::add(InternId user, InternId city) {
+    count++;
+    users.add(hash(user));
+    std::uint64_t cityHash = hash(city);
+    cities.add(cityHash);
+    cityTop.offer(city, cityCounts.add(cityHash));
+}
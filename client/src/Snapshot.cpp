@@ -0,0 +1,412 @@
+#include "../include/Snapshot.h"
+#include <cstring>
+#include <cerrno>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = {'S', 'T', 'O', 'M', 'P', 'S', 'N', 'P'};
+const std::size_t HEADER_BYTES = 16;
+const std::size_t FOOTER_BYTES = 24;
+const std::size_t DIRECTORY_ENTRY_BYTES = 24;
+const std::size_t BUFFER_BYTES = std::size_t(1) << 20;
+const std::size_t COLUMN_COUNT = 10;
+
+// Buffered sequential writer that tracks the file offset and aligns columns.
+class FileWriter
+{
+public:
+    explicit FileWriter(int fd) : fd(fd), buffer(), offset(0), ok(true) { buffer.reserve(BUFFER_BYTES); }
+
+    void put(const void *data, std::size_t length) {
+        buffer.append(static_cast<const char *>(data), length);
+        offset += length;
+        if (buffer.size() >= BUFFER_BYTES) flush();
+    }
+    void putU32(std::uint32_t value) { put(&value, 4); }
+    void putU64(std::uint64_t value) { put(&value, 8); }
+    void align() {
+        static const char zeros[8] = {0};
+        if (offset % 8 != 0) put(zeros, 8 - offset % 8);
+    }
+    std::uint64_t position() const { return offset; }
+
+    bool flush() {
+        const char *data = buffer.data();
+        std::size_t length = buffer.size();
+        while (ok && length > 0) {
+            ssize_t written = ::write(fd, data, length);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                ok = false;
+                break;
+            }
+            data += written;
+            length -= static_cast<std::size_t>(written);
+        }
+        buffer.clear();
+        return ok;
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    std::uint64_t offset;
+    bool ok;
+};
+
+// Assigns dictionary indexes to distinct strings, interned or not.
+class DictionaryBuilder
+{
+public:
+    DictionaryBuilder() : entries(), byId(), byText() {}
+
+    std::uint32_t add(InternId id) {
+        std::unordered_map<InternId, std::uint32_t>::const_iterator it = byId.find(id);
+        if (it != byId.end()) return it->second;
+        std::uint32_t index = add(StringInterner::instance().lookup(id));
+        byId[id] = index;
+        return index;
+    }
+
+    std::uint32_t add(const std::string &text) { // text must outlive the builder
+        std::unordered_map<std::string, std::uint32_t>::const_iterator it = byText.find(text);
+        if (it != byText.end()) return it->second;
+        std::uint32_t index = static_cast<std::uint32_t>(entries.size());
+        entries.push_back(&text);
+        byText[text] = index;
+        return index;
+    }
+
+    const std::vector<const std::string *> &strings() const { return entries; }
+
+private:
+    std::vector<const std::string *> entries;
+    std::unordered_map<InternId, std::uint32_t> byId;
+    std::unordered_map<std::string, std::uint32_t> byText;
+};
+
+struct ColumnSpan {
+    const char *data;
+    std::uint64_t length;
+};
+
+template <typename T>
+T readAt(const char *data, std::size_t index) {
+    T value;
+    std::memcpy(&value, data + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+void unmapSnapshot(char *data, std::size_t length) {
+    ::munmap(data, length);
+}
+
+} // namespace
+
+const std::uint32_t Snapshot::VERSION;
+
+bool Snapshot::write(const std::string &path, const EventStore &store, const std::vector<InternId> &channels,
+                     std::size_t &rows) {
+    return write(path, std::vector<const EventStore *>(1, &store), channels, rows);
+}
+
+bool Snapshot::write(const std::string &path, const std::vector<const EventStore *> &stores,
+                     const std::vector<InternId> &channels, std::size_t &rows) {
+    struct ChannelRange {
+        std::uint32_t dictionaryId;
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    // Gather rows grouped by channel and build the dictionary.
+    DictionaryBuilder dictionary;
+    std::vector<const Event *> events;
+    std::vector<ChannelRange> ranges;
+    for (InternId channel : channels) {
+        ChannelRange range = {dictionary.add(channel), static_cast<std::uint32_t>(events.size()), 0};
+        for (const EventStore *store : stores) {
+            store->forEach(channel, [&](const Event &event) { events.push_back(&event); });
+        }
+        range.count = static_cast<std::uint32_t>(events.size()) - range.first;
+        ranges.push_back(range);
+    }
+    std::vector<std::uint32_t> channelNames, users, cities, names;
+    for (const Event *event : events) {
+        channelNames.push_back(dictionary.add(event->get_channel_id()));
+        users.push_back(dictionary.add(event->getEventOwnerUserId()));
+        cities.push_back(dictionary.add(event->get_city_id()));
+        names.push_back(dictionary.add(event->get_name_id()));
+    }
+    std::vector<std::uint32_t> overflow;
+    std::vector<std::uint32_t> overflowStart(1, 0);
+    for (const Event *event : events) {
+        event->get_general_information().forEachOverflow([&](const std::string &key, const std::string &value) {
+            overflow.push_back(dictionary.add(key));
+            overflow.push_back(dictionary.add(value));
+        });
+        overflowStart.push_back(static_cast<std::uint32_t>(overflow.size() / 2));
+    }
+
+    // Written next to path, then renamed over it: a loaded snapshot stays mapped (its events keep
+    // views into it), so the target must never be truncated, and a failed write leaves it intact.
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    FileWriter out(fd);
+    std::uint64_t offsets[COLUMN_COUNT + 1];
+    std::uint64_t ends[COLUMN_COUNT + 1];
+
+    out.put(MAGIC, sizeof(MAGIC));
+    out.putU32(VERSION);
+    out.putU32(0);
+
+    const std::vector<const std::string *> &strings = dictionary.strings();
+    offsets[DICTIONARY] = out.position();
+    out.putU32(static_cast<std::uint32_t>(strings.size()));
+    std::uint32_t stringOffset = 0;
+    for (const std::string *text : strings) {
+        out.putU32(stringOffset);
+        stringOffset += static_cast<std::uint32_t>(text->size());
+    }
+    out.putU32(stringOffset);
+    for (const std::string *text : strings) {
+        out.put(text->data(), text->size());
+    }
+    ends[DICTIONARY] = out.position();
+    out.align();
+
+    offsets[CHANNEL_INDEX] = out.position();
+    for (const ChannelRange &range : ranges) {
+        out.putU32(range.dictionaryId);
+        out.putU32(range.first);
+        out.putU32(range.count);
+    }
+    ends[CHANNEL_INDEX] = out.position();
+    out.align();
+
+    const std::vector<std::uint32_t> *idColumns[] = {&channelNames, &users, &cities, &names};
+    const Column idColumnIds[] = {CHANNEL_NAME, USER, CITY, NAME};
+    for (int i = 0; i < 4; i++) {
+        offsets[idColumnIds[i]] = out.position();
+        out.put(idColumns[i]->data(), idColumns[i]->size() * 4);
+        ends[idColumnIds[i]] = out.position();
+        out.align();
+    }
+
+    offsets[DATE_TIME] = out.position();
+    for (const Event *event : events) {
+        out.putU32(static_cast<std::uint32_t>(event->get_date_time()));
+    }
+    ends[DATE_TIME] = out.position();
+    out.align();
+
+    offsets[FLAGS] = out.position();
+    for (const Event *event : events) {
+        std::uint8_t bits = event->get_general_information().presentBits();
+        out.put(&bits, 1);
+    }
+    for (const Event *event : events) {
+        std::uint8_t bits = event->get_general_information().valueBits();
+        out.put(&bits, 1);
+    }
+    ends[FLAGS] = out.position();
+    out.align();
+
+    offsets[OVERFLOW_ENTRIES] = out.position();
+    out.put(overflowStart.data(), overflowStart.size() * 4);
+    out.put(overflow.data(), overflow.size() * 4);
+    ends[OVERFLOW_ENTRIES] = out.position();
+    out.align();
+
+    offsets[DESCRIPTION] = out.position();
+    std::uint64_t descriptionOffset = 0;
+    for (const Event *event : events) {
+        out.putU64(descriptionOffset);
+        descriptionOffset += event->get_description().size();
+    }
+    out.putU64(descriptionOffset);
+    for (const Event *event : events) {
+        StringRef description = event->get_description();
+        out.put(description.data(), description.size());
+    }
+    ends[DESCRIPTION] = out.position();
+    out.align();
+
+    std::uint64_t directoryOffset = out.position();
+    for (std::uint32_t column = DICTIONARY; column <= COLUMN_COUNT; column++) {
+        out.putU32(column);
+        out.putU32(0);
+        out.putU64(offsets[column]);
+        out.putU64(ends[column] - offsets[column]);
+    }
+    out.putU64(directoryOffset);
+    out.putU32(static_cast<std::uint32_t>(COLUMN_COUNT));
+    out.putU32(static_cast<std::uint32_t>(events.size()));
+    out.put(MAGIC, sizeof(MAGIC));
+
+    bool written = out.flush();
+    written = ::close(fd) == 0 && written;
+    if (!written || ::rename(temporary.c_str(), path.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+        return false;
+    }
+    rows = events.size();
+    return true;
+}
+
+bool Snapshot::load(const std::string &path, EventStore &store, std::size_t &rows) {
+    return load(path, [&store](InternId) -> EventStore & { return store; }, rows);
+}
+
+bool Snapshot::load(const std::string &path, const EventStoreRouter &storeOf, std::size_t &rows) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < HEADER_BYTES + FOOTER_BYTES) {
+        ::close(fd);
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    if (size > UINT32_MAX) {
+        ::close(fd); // Events address descriptions with 32-bit offsets into the mapping
+        return false;
+    }
+    void *memory = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) return false;
+    // Loaded events keep views into the mapping; it is unmapped with the last of them.
+    FrameRef frame(FrameBuffer::adopt(static_cast<char *>(memory), size, unmapSnapshot));
+    const char *data = frame->data();
+
+    // Validate the header, footer and directory before touching any column.
+    const char *footer = data + size - FOOTER_BYTES;
+    std::uint64_t directoryOffset = readAt<std::uint64_t>(footer, 0);
+    std::uint32_t columnCount = readAt<std::uint32_t>(footer + 8, 0);
+    std::uint32_t rowCount = readAt<std::uint32_t>(footer + 12, 0);
+    if (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || std::memcmp(footer + 16, MAGIC, sizeof(MAGIC)) != 0 ||
+        readAt<std::uint32_t>(data + 8, 0) != VERSION || directoryOffset > size - FOOTER_BYTES ||
+        columnCount > (size - FOOTER_BYTES - directoryOffset) / DIRECTORY_ENTRY_BYTES) {
+        return false;
+    }
+    ColumnSpan columns[COLUMN_COUNT + 1] = {};
+    for (std::uint32_t i = 0; i < columnCount; i++) {
+        const char *entry = data + directoryOffset + i * DIRECTORY_ENTRY_BYTES;
+        std::uint32_t column = readAt<std::uint32_t>(entry, 0);
+        std::uint64_t offset = readAt<std::uint64_t>(entry + 8, 0);
+        std::uint64_t length = readAt<std::uint64_t>(entry + 16, 0);
+        if (offset > size || length > size - offset) return false;
+        if (column >= DICTIONARY && column <= COLUMN_COUNT) {
+            columns[column] = ColumnSpan{data + offset, length};
+        }
+    }
+    const std::uint64_t fixed = std::uint64_t(rowCount) * 4;
+    if (columns[DICTIONARY].length < 4 || columns[CHANNEL_NAME].length < fixed || columns[USER].length < fixed ||
+        columns[CITY].length < fixed || columns[NAME].length < fixed || columns[DATE_TIME].length < fixed ||
+        columns[FLAGS].length < std::uint64_t(rowCount) * 2 || columns[OVERFLOW_ENTRIES].length < fixed + 4 ||
+        columns[DESCRIPTION].length < (std::uint64_t(rowCount) + 1) * 8) {
+        return false;
+    }
+
+    const char *dictionary = columns[DICTIONARY].data;
+    std::uint32_t stringCount = readAt<std::uint32_t>(dictionary, 0);
+    if ((columns[DICTIONARY].length - 4) / 4 < std::uint64_t(stringCount) + 1) return false;
+    const char *stringOffsets = dictionary + 4;
+    const char *stringBytes = stringOffsets + (std::size_t(stringCount) + 1) * 4;
+    std::uint64_t stringSpace = columns[DICTIONARY].length - 4 - (std::uint64_t(stringCount) + 1) * 4;
+    std::uint32_t previousOffset = 0;
+    for (std::uint32_t i = 0; i <= stringCount; i++) {
+        std::uint32_t offset = readAt<std::uint32_t>(stringOffsets, i);
+        if (offset < previousOffset || offset > stringSpace) return false;
+        previousOffset = offset;
+    }
+    std::vector<InternId> interned(stringCount, 0);
+    std::vector<bool> isInterned(stringCount, false);
+    auto text = [&](std::uint32_t index) { // Offsets checked above: ascending and within the string bytes
+        std::uint32_t begin = readAt<std::uint32_t>(stringOffsets, index);
+        return StringRef(stringBytes + begin, readAt<std::uint32_t>(stringOffsets, index + 1) - begin);
+    };
+    auto intern = [&](std::uint32_t index) {
+        if (!isInterned[index]) {
+            StringRef value = text(index);
+            interned[index] = StringInterner::instance().intern(value.data(), value.size());
+            isInterned[index] = true;
+        }
+        return interned[index];
+    };
+
+    const char *overflowStart = columns[OVERFLOW_ENTRIES].data;
+    const char *overflowPairs = overflowStart + (std::size_t(rowCount) + 1) * 4;
+    std::uint64_t pairCount = (columns[OVERFLOW_ENTRIES].length - fixed - 4) / 8;
+    const char *descriptionOffsets = columns[DESCRIPTION].data;
+    const char *descriptionBytes = descriptionOffsets + (std::size_t(rowCount) + 1) * 8;
+    std::uint64_t descriptionSpace = columns[DESCRIPTION].length - (std::uint64_t(rowCount) + 1) * 8;
+    const char *flags = columns[FLAGS].data;
+
+    // Check every range and row first, so a malformed file adds nothing to the store.
+    std::uint64_t rangeCount = columns[CHANNEL_INDEX].length / 12;
+    for (std::uint64_t r = 0; r < rangeCount; r++) {
+        const char *range = columns[CHANNEL_INDEX].data + r * 12;
+        std::uint32_t channelIndex = readAt<std::uint32_t>(range, 0);
+        std::uint32_t first = readAt<std::uint32_t>(range, 1);
+        std::uint32_t count = readAt<std::uint32_t>(range, 2);
+        if (channelIndex >= stringCount || first > rowCount || count > rowCount - first) return false;
+
+        for (std::uint32_t row = first; row < first + count; row++) {
+            std::uint64_t descriptionBegin = readAt<std::uint64_t>(descriptionOffsets, row);
+            std::uint64_t descriptionEnd = readAt<std::uint64_t>(descriptionOffsets, row + 1);
+            std::uint32_t pairBegin = readAt<std::uint32_t>(overflowStart, row);
+            std::uint32_t pairEnd = readAt<std::uint32_t>(overflowStart, row + 1);
+            if (readAt<std::uint32_t>(columns[CHANNEL_NAME].data, row) >= stringCount ||
+                readAt<std::uint32_t>(columns[USER].data, row) >= stringCount ||
+                readAt<std::uint32_t>(columns[CITY].data, row) >= stringCount ||
+                readAt<std::uint32_t>(columns[NAME].data, row) >= stringCount ||
+                descriptionBegin > descriptionEnd || descriptionEnd > descriptionSpace ||
+                pairBegin > pairEnd || pairEnd > pairCount) {
+                return false;
+            }
+            for (std::uint32_t pair = pairBegin; pair < pairEnd; pair++) {
+                if (readAt<std::uint32_t>(overflowPairs, pair * 2) >= stringCount ||
+                    readAt<std::uint32_t>(overflowPairs, pair * 2 + 1) >= stringCount) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    rows = 0;
+    for (std::uint64_t r = 0; r < rangeCount; r++) {
+        const char *range = columns[CHANNEL_INDEX].data + r * 12;
+        InternId channel = intern(readAt<std::uint32_t>(range, 0));
+        std::uint32_t first = readAt<std::uint32_t>(range, 1);
+        std::uint32_t count = readAt<std::uint32_t>(range, 2);
+
+        for (std::uint32_t row = first; row < first + count; row++) {
+            std::uint64_t descriptionBegin = readAt<std::uint64_t>(descriptionOffsets, row);
+            std::uint64_t descriptionEnd = readAt<std::uint64_t>(descriptionOffsets, row + 1);
+            GeneralInformation information(static_cast<std::uint8_t>(flags[row]),
+                                           static_cast<std::uint8_t>(flags[rowCount + row]));
+            for (std::uint32_t pair = readAt<std::uint32_t>(overflowStart, row);
+                 pair < readAt<std::uint32_t>(overflowStart, row + 1); pair++) {
+                information.set(text(readAt<std::uint32_t>(overflowPairs, pair * 2)),
+                                text(readAt<std::uint32_t>(overflowPairs, pair * 2 + 1)));
+            }
+            StringRef description(descriptionBytes + descriptionBegin,
+                                  static_cast<std::size_t>(descriptionEnd - descriptionBegin));
+            storeOf(channel).add(channel, Event(intern(readAt<std::uint32_t>(columns[CHANNEL_NAME].data, row)),
+                                                intern(readAt<std::uint32_t>(columns[CITY].data, row)),
+                                                intern(readAt<std::uint32_t>(columns[NAME].data, row)),
+                                                static_cast<int>(readAt<std::uint32_t>(columns[DATE_TIME].data, row)),
+                                                frame, description, std::move(information),
+                                                intern(readAt<std::uint32_t>(columns[USER].data, row))));
+            rows++;
+        }
+    }
+    return true;
+}
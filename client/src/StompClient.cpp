@@ -1,27 +1,69 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include "StompProtocol.h"
+#include "SpscRing.h"
+#include "SessionManager.h"
+#include "CommandScript.h"
+#include "Query.h"
+#include "Metrics.h"
 #include "ConnectionHandler.h"
 #include "keyboardInput.h"
 
 std::mutex mutex; // Ensures thread safety when modifying shared objects
 
 
-// Listens for incoming STOMP messages from the server, used for the thread in charge of communication
-void communicate(StompProtocol*& protocol, ConnectionHandler*& connectionHandler) {
-    std::string response;
-    while (!protocol->shouldStopCommunication()) {
+// Frames handed from the socket reader to the dispatcher; an empty FrameRef marks the end of the connection.
+typedef SpscRing<FrameRef, 256> FrameRing;
 
-        response.clear();  // Ensure response is empty before reading a new frame
+// Reads frames off the socket and only finds their boundaries, used for the reader thread.
+void readFrames(ConnectionHandler* connectionHandler, FrameRing* frames) {
+    while (true) {
+        // Read the next frame into its own retained buffer (the only copy from the socket)
+        FrameRef frame;
+        if (!connectionHandler->getFrame(frame, '\0')) {
+            frames->push(FrameRef());
+            return;
+        }
+        Metrics::add(Metrics::READER_QUEUED);
+        frames->push(std::move(frame));
+    }
+}
 
-        if (!connectionHandler->getFrameAscii(response, '\0')) {
-            std::cerr << "Server connection lost." << std::endl;
-            protocol->signalStopCommunication();
-            break;
+// Dispatches incoming STOMP messages from the server, used for the thread in charge of communication
+void communicate(StompProtocol*& protocol, ConnectionHandler*& connectionHandler) {
+    {
+        FrameRing frames;
+        std::thread reader(readFrames, connectionHandler, &frames);
+
+        FrameRef frame;
+        bool ended = false; // The reader's end marker was taken
+        while (!protocol->shouldStopCommunication()) {
+            frames.pop(frame);
+            if (!frame) {
+                if (!protocol->shouldStopCommunication()) {
+                    std::cerr << "Server connection lost." << std::endl;
+                    protocol->signalStopCommunication();
+                }
+                ended = true;
+                break;
+            }
+            Metrics::add(Metrics::READER_TAKEN);
+            protocol->parseFrame(frame);
+            frame = FrameRef(); // Lets the reader's arena reuse the block
         }
 
-        protocol->parseFrame(response);
+        // Wake the reader even if the server keeps the connection open, and wait for its end marker
+        connectionHandler->shutdown();
+        while (!ended) {
+            frames.pop(frame);
+            ended = !frame;
+            if (!ended) Metrics::add(Metrics::READER_TAKEN);
+        }
+        reader.join();
     }
 
     // Exiting loop means logged out or error occured.
@@ -29,15 +71,20 @@ void communicate(StompProtocol*& protocol, ConnectionHandler*& connectionHandler
     // Store if error occured before deleteing protocol.
     bool error = protocol->hasErrorOccurred();
 
-    // Close the socket
-    connectionHandler->close();
+    {
+        // The main thread checks these pointers under the mutex when a batch script ends
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Close the socket
+        connectionHandler->close();
 
-    // Clean up resources
-    delete connectionHandler;
-    connectionHandler = nullptr;  // Prevent dangling pointer
+        // Clean up resources
+        delete connectionHandler;
+        connectionHandler = nullptr;  // Prevent dangling pointer
 
-    delete protocol;
-    protocol = nullptr;  // Prevent dangling pointer
+        delete protocol;
+        protocol = nullptr;  // Prevent dangling pointer
+    }
 
     // Terminate program if error occured
     if (error){
@@ -47,16 +94,125 @@ void communicate(StompProtocol*& protocol, ConnectionHandler*& connectionHandler
 
 int main(int argc, char *argv[]) {
     ConnectionHandler* connectionHandler = nullptr; // Pointer to manage connection
-    StompProtocol* protocol = nullptr; // Pointer to manage STOMP protocol
+    StompProtocol* defaultProtocol = nullptr; // Pointer to manage STOMP protocol of the unnamed session
 
     std::thread communicator; // Communication thread
 
-    std::string username; // Username for the current session
+    std::string defaultUsername; // Username for the unnamed session
+
+    // Memory policies of the event store, kept across sessions and applied at login
+    size_t memoryBudget = 0;     // Bytes, 0 = unlimited
+    long long eventTtl = 0;      // Seconds of event time, 0 = off
+    bool freeOnExit = false;     // Free a channel's events on exit
+    std::string arenaMode = "on"; // Event arena: on, off or huge (transparent huge pages)
+    std::string logDirectory;    // Event log root, empty = off; each user logs to a subdirectory
+    long long rollupWidth = RollupTable::DEFAULT_WIDTH; // Seconds per rollup bucket
+    bool latencyTracking = false; // Timestamp reports and record publish -> delivery latency
+
+    // Snapshot loaded into the store at every login ("--snapshot {file}" on the command line)
+    std::string snapshotPath;
+    // Threads parsing and storing MESSAGE frames, sharded by channel ("--workers {n}", 0 = dispatcher thread)
+    size_t workerCount = std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
+    // Threads reading the sockets of all named sessions ("--io-threads {n}")
+    size_t ioThreads = std::min(4u, std::max(1u, std::thread::hardware_concurrency()));
+    // Batch mode: commands come from a script ("--batch {file}"), timings go to "--results {file}"
+    std::string scriptPath, resultsPath;
+    // Prometheus text file rewritten every interval ("--metrics {file}", "--metrics-interval {seconds}")
+    std::string metricsPath;
+    double metricsInterval = 10;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--snapshot") {
+            snapshotPath = argv[++i];
+        } else if (std::string(argv[i]) == "--workers") {
+            workerCount = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--io-threads") {
+            ioThreads = std::stoul(argv[++i]);
+        } else if (std::string(argv[i]) == "--batch") {
+            scriptPath = argv[++i];
+        } else if (std::string(argv[i]) == "--results") {
+            resultsPath = argv[++i];
+        } else if (std::string(argv[i]) == "--metrics") {
+            metricsPath = argv[++i];
+        } else if (std::string(argv[i]) == "--metrics-interval") {
+            metricsInterval = std::stod(argv[++i]);
+        }
+    }
+    if (!(metricsInterval >= 0.001)) { // A zero interval would rewrite the file in a busy loop
+        std::cerr << "--metrics-interval needs at least 0.001 seconds" << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<MetricsDumper> metricsDumper;
+    if (!metricsPath.empty()) {
+        metricsDumper.reset(new MetricsDumper(metricsPath, static_cast<long long>(metricsInterval * 1000)));
+    }
+
+    CommandScript script;
+    std::string scriptError;
+    if (!scriptPath.empty() && !script.load(scriptPath, scriptError)) {
+        std::cerr << scriptError << std::endl;
+        return 1;
+    }
+    // One row per script command: when it started and when the client was done with it,
+    // in microseconds since the script started
+    std::ofstream results;
+    if (!resultsPath.empty()) {
+        results.open(resultsPath.c_str());
+        results << "index,line,command,start_us,end_us\n";
+    }
+    std::chrono::steady_clock::time_point scriptStart = std::chrono::steady_clock::now();
+    CommandScript::Command scriptCommand = {0, ""};
+    size_t commandIndex = 0;
+    long long commandStart = -1; // Start of the command whose row is pending, -1 = none
+    std::function<long long()> elapsedMicros = [&scriptStart]() {
+        return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - scriptStart).count());
+    };
+    std::function<void()> recordCommand = [&]() {
+        if (commandStart >= 0 && results.is_open()) {
+            std::string text = scriptCommand.text;
+            std::replace(text.begin(), text.end(), '"', '\'');
+            results << commandIndex << ',' << scriptCommand.line << ",\"" << text << "\"," << commandStart << ','
+                    << elapsedMicros() << '\n';
+        }
+        commandStart = -1;
+    };
+
+    // Named sessions ("@{name} {command}"), read by a shared I/O thread pool
+    SessionManager sessions(ioThreads);
+
+    // Applies the settings kept across sessions to a new session's protocol
+    std::function<void(StompProtocol&, const std::string&)> applySettings =
+        [&](StompProtocol& protocol, const std::string& username) {
+            protocol.setMemoryBudget(memoryBudget);
+            protocol.setEventTtl(eventTtl);
+            protocol.setFreeOnUnsubscribe(freeOnExit);
+            protocol.setEventArena(arenaMode != "off", arenaMode == "huge");
+            protocol.setRollupWidth(rollupWidth);
+            protocol.setLatencyTracking(latencyTracking);
+            if (!snapshotPath.empty()) {
+                protocol.loadSnapshot(snapshotPath);
+            }
+            if (!logDirectory.empty()) {
+                protocol.openEventLog(logDirectory + "/" + username, true); // Restores the previous sessions' events
+            }
+        };
 
     std::string userInput;
     while (true) {
 
-        userInput = KeyboardInput::readLine();
+        if (scriptPath.empty()) {
+            userInput = KeyboardInput::readLine();
+        } else {
+            // The previous command is done once the loop comes back here
+            recordCommand();
+            if (!script.next(scriptCommand)) {
+                break;
+            }
+            commandIndex++;
+            commandStart = elapsedMicros();
+            userInput = scriptCommand.text;
+        }
 
         std::vector<std::string> tokens;
         KeyboardInput::split_str(userInput, ' ', tokens); // Use split_str to parse user input
@@ -66,7 +222,56 @@ int main(int argc, char *argv[]) {
 
         if (tokens.empty()) continue;
 
-        if (command == "login") {
+        // "@{name} {command}" runs the command on a named session; login opens it
+        std::string sessionName;
+        if (command.size() > 1 && command[0] == '@') {
+            sessionName = command.substr(1);
+            userInput = userInput.substr(userInput.find(command) + command.size());
+            tokens.erase(tokens.begin());
+            if (tokens.empty()) continue;
+            command = tokens[0];
+        }
+        SessionManager::Session* session = sessionName.empty() ? nullptr : sessions.find(sessionName);
+        StompProtocol* protocol = sessionName.empty() ? defaultProtocol : (session ? session->protocol.get() : nullptr);
+        std::string& username = session ? session->username : defaultUsername;
+
+        if (command == "sessions") {
+            sessions.print();
+        }
+
+        else if (command == "sleep") {
+            // "sleep {seconds}", fractions allowed
+            double seconds = -1;
+            try {
+                seconds = tokens.size() == 2 ? std::stod(tokens[1]) : -1;
+            } catch (const std::exception&) {
+            }
+            if (seconds < 0) {
+                std::cerr << "sleep command needs 1 arg: {seconds}" << std::endl;
+                continue;
+            }
+            std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        }
+
+        else if (command == "wait-receipt") {
+            // "wait-receipt [{timeout seconds}]" waits until the server acknowledged the login and every request
+            double timeout = 10;
+            try {
+                timeout = tokens.size() == 2 ? std::stod(tokens[1]) : timeout;
+            } catch (const std::exception&) {
+            }
+            if (!protocol) {
+                std::cerr << "Please login first" << std::endl;
+                continue;
+            }
+            if (!protocol->waitForReceipts(static_cast<long long>(timeout * 1000))) {
+                std::cerr << "Timed out waiting for receipts" << std::endl;
+                continue;
+            }
+            protocol->drainWorkers(); // MESSAGEs received before the last receipt are stored too
+        }
+
+        else if (command == "login") {
 
             // Make sure the command has the correct number of arguments
             if (tokens.size() != 4) {
@@ -75,7 +280,7 @@ int main(int argc, char *argv[]) {
             }
 
             // Make sure user is not already logged in
-            if (protocol && protocol->isConnected()) {
+            if (session || (protocol && protocol->isConnected())) {
                 std::cerr << "user already logged in" << std::endl;
                 continue;
             }
@@ -93,35 +298,50 @@ int main(int argc, char *argv[]) {
             short serverPort = std::stoi(hostPort.substr(colonPosition + 1));
 
 			// Extract username and password
-            username = tokens[2];
+            std::string user = tokens[2];
             std::string password = tokens[3];
 
+            // Send CONNECT frame once connected
+            std::map<std::string, std::string> headers = {
+                {"accept-version", "1.2"},
+                {"host", "stomp.cs.bgu.ac.il"},
+                {"login", user},
+                {"passcode", password}
+            };
+
+            // A named session is connected and then read by the shared I/O threads
+            if (!sessionName.empty()) {
+                session = sessions.open(sessionName, serverHost, serverPort, user,
+                                        [&](StompProtocol& opened) { applySettings(opened, user); });
+                if (!session) {
+                    std::cerr << "Could not connect to server: Make sure server is running, ip and host are correct, and that you have internet connection." << std::endl;
+                    continue;
+                }
+                session->protocol->send("CONNECT", headers, "");
+                continue;
+            }
+
             // Create connectionHandler and protocol
+            defaultUsername = user;
             connectionHandler = new ConnectionHandler(serverHost, serverPort);
-            protocol = new StompProtocol(*connectionHandler);
+            defaultProtocol = new StompProtocol(*connectionHandler, workerCount);
 
             // Connect to server
             if (!connectionHandler->connect()) {
                 std::cerr << "Could not connect to server: Make sure server is running, ip and host are correct, and that you have internet connection." << std::endl;
                 // Cleanup
                 delete connectionHandler;
-                delete protocol;
+                delete defaultProtocol;
                 connectionHandler = nullptr;
-                protocol = nullptr;
+                defaultProtocol = nullptr;
                 continue;
             }
+            applySettings(*defaultProtocol, defaultUsername); // Only once connected, as for named sessions
 
-            // Send CONNECT frame
-            std::map<std::string, std::string> headers = {
-                {"accept-version", "1.2"},
-                {"host", "stomp.cs.bgu.ac.il"},
-                {"login", username},
-                {"passcode", password}
-            };
-            protocol->send("CONNECT", headers, "");
+            defaultProtocol->send("CONNECT", headers, "");
 
             // Start communication thread with pointer references
-            communicator = std::thread(communicate, std::ref(protocol), std::ref(connectionHandler));
+            communicator = std::thread(communicate, std::ref(defaultProtocol), std::ref(connectionHandler));
         }
 
         else if (command == "join") {
@@ -232,22 +452,12 @@ int main(int argc, char *argv[]) {
                 std::map<std::string, std::string> headers = {
                     {"destination", parsedEvents.channel_name} // Send to the correct channel
                 };
-
-                // Construct the body in the correct format
-                std::string body = "user:" + username + "\n" +
-                                "city:" + event.get_city() + "\n" +
-                                "event name:" + event.get_name() + "\n" +
-                                "date time:" + std::to_string(event.get_date_time()) + "\n" +
-                                "general information:\n";
-
-                for (std::map<std::string, std::string>::const_iterator it = event.get_general_information().begin(); 
-                    it != event.get_general_information().end(); ++it) {
-                    const std::string& key = it->first;
-                    const std::string& value = it->second;
-                    body += " " + key + ":" + value + "\n";  // Ensure proper formatting
+                if (protocol->isLatencyTracking()) {
+                    headers["timestamp"] = std::to_string(LatencyHistogram::now()); // Nanoseconds, forwarded on MESSAGE
                 }
 
-                body += "description:\n" + event.get_description() + "\n";
+                // Construct the body in the correct format
+                std::string body = formatEventBody(username, event);
 
                 // Send the formatted SEND frame to the server
                 protocol->send("SEND", headers, body);
@@ -259,9 +469,17 @@ int main(int argc, char *argv[]) {
 
         else if (command == "summary") {
 
+            // Optional date_time window: --from {epoch} --to {epoch} (inclusive)
+            long long from = LLONG_MIN, to = LLONG_MAX;
+            std::string rangeError;
+            if (!Query::takeRange(tokens, from, to, rangeError)) {
+                std::cerr << rangeError << std::endl;
+                continue;
+            }
+
             // Check argument count
             if (tokens.size() != 4) {
-                std::cerr << "summary command needs 3 args: {channel_name} {user} {file}" << std::endl;
+                std::cerr << "summary command needs 3 args: {channel_name} {user} {file} [--from {epoch}] [--to {epoch}]" << std::endl;
                 continue;
             }
 
@@ -275,7 +493,199 @@ int main(int argc, char *argv[]) {
             std::string binPath = "../bin/" + tokens[3];
 
             // Call the summarize function with the correct file path
-            protocol->summarizeEmergencyChannel(tokens[1], tokens[2], binPath);
+            protocol->summarizeEmergencyChannel(tokens[1], tokens[2], binPath, from, to);
+        }
+
+        else if (command == "snapshot") {
+
+            // Check if the correct number of arguments is provided
+            if (tokens.size() != 3) {
+                std::cerr << "snapshot command needs 2 args: {channel_name|*} {file}" << std::endl;
+                continue;
+            }
+            if (!protocol || !protocol->isConnected()) {
+                std::cerr << "Please login first" << std::endl;
+                continue;
+            }
+            protocol->writeSnapshot(tokens[1], tokens[2]);
+        }
+
+        else if (command == "query") {
+
+            // The rest of the line is the query, it may contain quoted values
+            if (tokens.size() < 2) {
+                std::cerr << "query command needs args: {channel_name} [where {field} {op} {value} [and ...]] [group by {field}]" << std::endl;
+                continue;
+            }
+            if (!protocol || !protocol->isConnected()) {
+                std::cerr << "Please login first" << std::endl;
+                continue;
+            }
+            protocol->runQuery(userInput.substr(userInput.find("query") + 5));
+        }
+
+        else if (command == "search") {
+
+            // Everything after the channel is the search text
+            if (tokens.size() < 3) {
+                std::cerr << "search command needs 2 args: {channel_name} {terms}" << std::endl;
+                continue;
+            }
+            if (!protocol || !protocol->isConnected()) {
+                std::cerr << "Please login first" << std::endl;
+                continue;
+            }
+            size_t termsStart = userInput.find(tokens[1], userInput.find("search") + 6) + tokens[1].size();
+            termsStart = userInput.find_first_not_of(' ', termsStart);
+            protocol->search(tokens[1], userInput.substr(termsStart));
+        }
+
+        else if (command == "stats") {
+
+            // Without a channel: the client's own metrics, available at any time
+            if (tokens.size() == 1) {
+                Metrics::print(std::cout);
+                continue;
+            }
+            if (tokens.size() != 2) {
+                std::cerr << "stats command needs 0 or 1 args: [{channel_name}]" << std::endl;
+                continue;
+            }
+            if (!protocol || !protocol->isConnected()) {
+                std::cerr << "Please login first" << std::endl;
+                continue;
+            }
+            protocol->printChannelStats(tokens[1]);
+        }
+
+        else if (command == "rollup") {
+
+            // "rollup width {seconds}" sets the bucket width, "rollup {channel} [{file}]" prints or exports
+            if (tokens.size() != 2 && tokens.size() != 3) {
+                std::cerr << "rollup command needs 1 or 2 args: {channel_name} [{file}] | width {seconds}" << std::endl;
+                continue;
+            }
+            if (tokens[1] == "width" && tokens.size() == 3) {
+                long long width = 0;
+                try {
+                    width = std::stoll(tokens[2]);
+                } catch (const std::exception&) {
+                }
+                if (width <= 0) {
+                    std::cerr << "Invalid rollup width: " << tokens[2] << std::endl;
+                    continue;
+                }
+                rollupWidth = width;
+                if (protocol) {
+                    protocol->setRollupWidth(rollupWidth);
+                }
+                continue;
+            }
+            if (!protocol || !protocol->isConnected()) {
+                std::cerr << "Please login first" << std::endl;
+                continue;
+            }
+            protocol->printRollup(tokens[1], tokens.size() == 3 ? tokens[2] : "");
+        }
+
+        else if (command == "latency") {
+
+            // "latency on|off" sets tracking, "latency reset [{channel}]" clears, "latency [{channel}]" prints
+            if (tokens.size() > 3 || (tokens.size() == 3 && tokens[1] != "reset")) {
+                std::cerr << "latency command needs at most 1 arg: {channel_name} | on | off | reset [{channel_name}]" << std::endl;
+                continue;
+            }
+            if (tokens.size() == 2 && (tokens[1] == "on" || tokens[1] == "off")) {
+                latencyTracking = tokens[1] == "on";
+                if (protocol) {
+                    protocol->setLatencyTracking(latencyTracking);
+                }
+                continue;
+            }
+            if (!protocol || !protocol->isConnected()) {
+                std::cerr << "Please login first" << std::endl;
+                continue;
+            }
+            if (tokens.size() >= 2 && tokens[1] == "reset") {
+                protocol->resetLatency(tokens.size() == 3 ? tokens[2] : "");
+                continue;
+            }
+            protocol->printLatency(tokens.size() == 2 ? tokens[1] : "");
+        }
+
+        else if (command == "memory") {
+
+            // "memory" prints usage, "memory {budget|ttl|free-on-exit|arena} {value}" changes a policy
+            if (tokens.size() != 1 && tokens.size() != 3) {
+                std::cerr << "memory command needs 0 or 2 args: [{budget|ttl|free-on-exit|arena} {value}]" << std::endl;
+                continue;
+            }
+
+            if (tokens.size() == 3) {
+                try {
+                    if (tokens[1] == "budget") {
+                        memoryBudget = std::stoull(tokens[2]);
+                    } else if (tokens[1] == "ttl") {
+                        eventTtl = std::stoll(tokens[2]);
+                    } else if (tokens[1] == "free-on-exit" && (tokens[2] == "on" || tokens[2] == "off")) {
+                        freeOnExit = tokens[2] == "on";
+                    } else if (tokens[1] == "arena" && (tokens[2] == "on" || tokens[2] == "off" || tokens[2] == "huge")) {
+                        arenaMode = tokens[2];
+                    } else {
+                        std::cerr << "Unknown memory setting: " << tokens[1] << " " << tokens[2] << std::endl;
+                        continue;
+                    }
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid number: " << tokens[2] << std::endl;
+                    continue;
+                }
+            }
+
+            // Apply to the current session, if any
+            if (!protocol || !protocol->isConnected()) {
+                if (tokens.size() == 1) {
+                    std::cerr << "Please login first" << std::endl;
+                }
+                continue;
+            }
+            if (tokens.size() == 1) {
+                protocol->printMemoryUsage();
+            } else if (tokens[1] == "budget") {
+                protocol->setMemoryBudget(memoryBudget);
+            } else if (tokens[1] == "ttl") {
+                protocol->setEventTtl(eventTtl);
+            } else if (tokens[1] == "arena") {
+                protocol->setEventArena(arenaMode != "off", arenaMode == "huge");
+            } else {
+                protocol->setFreeOnUnsubscribe(freeOnExit);
+            }
+        }
+
+        else if (command == "log") {
+
+            // "log" prints the event log status, "log {directory|off}" enables or disables it
+            if (tokens.size() > 2) {
+                std::cerr << "log command needs 0 or 1 args: [{directory|off}]" << std::endl;
+                continue;
+            }
+            if (tokens.size() == 2) {
+                logDirectory = tokens[1] == "off" ? "" : tokens[1];
+            }
+
+            // Apply to the current session, if any
+            if (!protocol || !protocol->isConnected()) {
+                if (tokens.size() == 1) {
+                    std::cerr << "Please login first" << std::endl;
+                }
+                continue;
+            }
+            if (tokens.size() == 1) {
+                protocol->printEventLogStatus();
+            } else if (logDirectory.empty()) {
+                protocol->closeEventLog();
+            } else {
+                protocol->openEventLog(logDirectory + "/" + username, false); // The store already holds this session's events
+            }
         }
 
         else if (command == "logout") {
@@ -301,7 +711,12 @@ int main(int argc, char *argv[]) {
 
             // Wait for the communication thread to close and clean up resources, 
             // which is done when the server sends a RECEIPT frame for the discconect request (in the protocol)
-            communicator.join();
+            if (session) {
+                sessions.waitFinished(*session);
+                sessions.remove(sessionName);
+            } else {
+                communicator.join();
+            }
         }
 
         else {
@@ -309,5 +724,17 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // The script ended: stop the unnamed session's threads if it is still logged in
+    if (communicator.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex); // The communicator may be deleting them right now
+            if (defaultProtocol) {
+                defaultProtocol->signalStopCommunication();
+                connectionHandler->shutdown();
+            }
+        }
+        communicator.join();
+    }
+    results.close();
     return 0;
 }
@@ -1,24 +1,74 @@
 #include "StompProtocol.h"
+#include "DateFormatter.h"
+#include "SummaryWriter.h"
+#include "Snapshot.h"
+#include "Query.h"
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
-#include <ctime>
-#include <algorithm>
+#include <unistd.h>
 
 // Constructor initializes STOMP protocol with connection handler.
-StompProtocol::StompProtocol(ConnectionHandler &handler) :
+StompProtocol::StompProtocol(ConnectionHandler &handler, std::size_t workers) :
     connectionHandler(handler),  // Reference must be initialized first
     connected(false),
     stopCommunication(false),
     errorOccured(false),
+    latencyTracking(false),
     idCounter(0),   // Explicitly initialize counters
     receiptCounter(0),
-    eventSummary(),  // Optional, included for clarity (hash maps are initialized automaticcly in c++).
+    shards(),
+    eventLog(),
+    memoryBudget(0),
     receiptMap(),
+    receiptSentAt(),
+    receiptMutex(),
+    receiptsChanged(),
     subscriptionIds(),
-    connectionMutex(), 
-    errorMutex() {}    
+    workers() {
+    for (std::size_t i = 0; i < std::max<std::size_t>(workers, 1); i++) {
+        shards.push_back(std::unique_ptr<StoreShard>(new StoreShard()));
+    }
+    if (workers > 0) {
+        // Worker i stores exactly the channels of shard i, so a channel's events keep their order
+        this->workers.reset(new FrameWorkers(workers, [this](std::size_t, const FrameRef& frame) {
+            processFrame(frame);
+            Metrics::add(Metrics::WORKER_DONE);
+        }));
+    }
+}
+
+StompProtocol::~StompProtocol() {
+    workers.reset(); // Before the shards they store into
+}
+
+StompProtocol::StoreShard& StompProtocol::shardOf(InternId channel) {
+    return *shards[ChannelSketch::hash(channel) % shards.size()];
+}
+
+std::vector<std::unique_lock<std::mutex>> StompProtocol::lockAllShards() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    for (std::unique_ptr<StoreShard>& shard : shards) {
+        locks.push_back(std::unique_lock<std::mutex>(shard->storeMutex)); // Always in shard order
+    }
+    return locks;
+}
+
+EventStoreRouter StompProtocol::shardRouter() {
+    return [this](InternId channel) -> EventStore& { return shardOf(channel).eventSummary; };
+}
+
+// Called first by the commands that read the store, so they see every MESSAGE the server
+// delivered before the command, as they would without workers. Keyboard thread only.
+void StompProtocol::drainWorkers() {
+    if (workers) {
+        workers->drain();
+    }
+}
 
 int StompProtocol::getNextId() {
     return idCounter++;  // Generate a unique ID for subscriptions
@@ -29,23 +79,416 @@ int StompProtocol::getNextReceiptId() {
 }
 
 int StompProtocol::getSubscriptionId(const std::string& channel) {
-    if (subscriptionIds.find(channel) != subscriptionIds.end()) {
-        return subscriptionIds[channel];
+    InternId channelId;
+    if (StringInterner::instance().find(channel, channelId) && subscriptionIds.find(channelId) != subscriptionIds.end()) {
+        return subscriptionIds[channelId];
     }
     return -1;  // Return -1 if not found
 }
 
 void StompProtocol::storeSubscriptionId(const std::string& channel, int subscriptionId) {
-    subscriptionIds[channel] = subscriptionId;
+    subscriptionIds[StringInterner::instance().intern(channel)] = subscriptionId;
 }
 
 void StompProtocol::removeSubscription(const std::string& channel) {
-    subscriptionIds.erase(channel);
+    InternId channelId;
+    if (StringInterner::instance().find(channel, channelId)) {
+        subscriptionIds.erase(channelId);
+
+        // Free the channel's events if the unsubscribe eviction policy is on
+        StoreShard& shard = shardOf(channelId);
+        std::lock_guard<std::mutex> lock(shard.storeMutex);
+        if (shard.eventSummary.freeOnUnsubscribe()) {
+            shard.eventSummary.dropChannel(channelId);
+            if (eventLog) {
+                eventLog->appendDrop(channelId); // So replay and compaction drop it too
+            }
+        }
+    }
+}
+
+// Sets the memory budget of stored events in bytes (0 = unlimited), split evenly over the shards.
+void StompProtocol::setMemoryBudget(size_t bytes) {
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    memoryBudget = bytes;
+    for (std::unique_ptr<StoreShard>& shard : shards) {
+        shard->eventSummary.setBudget((bytes + shards.size() - 1) / shards.size());
+    }
+}
+
+// Sets the age limit of stored events in seconds of event time (0 = disabled).
+// Each shard expires against the newest date_time among its own channels.
+void StompProtocol::setEventTtl(long long seconds) {
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    for (std::unique_ptr<StoreShard>& shard : shards) {
+        shard->eventSummary.setTtl(seconds);
+    }
+    if (eventLog) {
+        eventLog->setTtl(seconds);
+    }
+}
+
+// Sets whether exiting a channel frees its stored events.
+void StompProtocol::setFreeOnUnsubscribe(bool enabled) {
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    for (std::unique_ptr<StoreShard>& shard : shards) {
+        shard->eventSummary.setFreeOnUnsubscribe(enabled);
+    }
+}
+
+// Sets whether descriptions of stored events are copied into per-channel arenas.
+void StompProtocol::setEventArena(bool enabled, bool hugePages) {
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    for (std::unique_ptr<StoreShard>& shard : shards) {
+        shard->eventSummary.setArena(enabled, hugePages);
+    }
+}
+
+namespace {
+
+// Resident set size of the process, 0 if /proc is not available.
+size_t residentBytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) return 0;
+    return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+} // namespace
+
+// Prints memory used by stored events, per channel, and eviction counts.
+void StompProtocol::printMemoryUsage() {
+    drainWorkers();
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    const EventStore& firstStore = shards[0]->eventSummary;
+    EventStore::Usage usage = firstStore.usage();
+    usage.budget = memoryBudget;
+    std::vector<EventStore::ChannelUsage> channels = firstStore.channelUsage();
+    for (size_t i = 1; i < shards.size(); i++) {
+        const EventStore& store = shards[i]->eventSummary;
+        EventStore::Usage shardUsage = store.usage();
+        usage.bytes += shardUsage.bytes;
+        usage.events += shardUsage.events;
+        usage.evictedByBudget += shardUsage.evictedByBudget;
+        usage.evictedByTtl += shardUsage.evictedByTtl;
+        usage.evictedByUnsubscribe += shardUsage.evictedByUnsubscribe;
+        std::vector<EventStore::ChannelUsage> shardChannels = store.channelUsage();
+        channels.insert(channels.end(), shardChannels.begin(), shardChannels.end());
+    }
+
+    std::cout << "Memory: " << usage.bytes << " bytes in " << usage.events << " events (budget: ";
+    if (usage.budget == 0) std::cout << "unlimited"; else std::cout << usage.budget << " bytes";
+    std::cout << ", ttl: ";
+    if (usage.ttl == 0) std::cout << "off"; else std::cout << usage.ttl << "s";
+    std::cout << ", free on exit: " << (usage.freeOnUnsubscribe ? "on" : "off") << ")" << std::endl;
+
+    for (const EventStore::ChannelUsage& channel : channels) {
+        std::cout << "Channel " << StringInterner::instance().lookup(channel.channel) << ": "
+                  << channel.events << " events, " << channel.bytes << " bytes" << std::endl;
+    }
+
+    std::cout << "Evicted: " << usage.evictedByBudget << " by budget, " << usage.evictedByTtl << " by ttl, "
+              << usage.evictedByUnsubscribe << " by unsubscribe" << std::endl;
+
+    EventArena::Totals arena = EventArena::totals();
+    std::cout << "Arena: " << (firstStore.arenaEnabled() ? (firstStore.arenaHugePages() ? "huge pages" : "on") : "off")
+              << ", " << arena.blocks << " blocks, " << arena.mappedBytes << " bytes mapped" << std::endl;
+    std::cout << "RSS: " << residentBytes() << " bytes (live event bytes: " << usage.bytes << ")" << std::endl;
+}
+
+// Logs received events in directory. At login, the events logged there by earlier sessions
+// are replayed into the store first; a log opened mid-session is not replayed, since its
+// segments may hold events this session already stored.
+bool StompProtocol::openEventLog(const std::string& directory, bool replay) {
+    closeEventLog();
+
+    std::unique_ptr<EventLog> log(new EventLog(directory));
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    EventLog::ReplayResult replayed = {0, 0, 0, 0};
+    if (replay) {
+        replayed = log->replay(shardRouter());
+    }
+    if (replayed.segments > 0) {
+        std::cout << "Replayed " << replayed.events << " events from " << replayed.segments << " log segments ("
+                  << replayed.bytes << " bytes) in " << static_cast<long long>(replayed.seconds * 1000) << " ms";
+        if (replayed.seconds > 0) {
+            std::cout << ", " << static_cast<long long>(replayed.events / replayed.seconds) << " events/s";
+        }
+        std::cout << std::endl;
+    }
+    if (!log->open()) {
+        return false;
+    }
+    log->setTtl(shards[0]->eventSummary.usage().ttl);
+    eventLog = std::move(log);
+    return true;
+}
+
+// Stops logging; records appended so far are committed first.
+void StompProtocol::closeEventLog() {
+    std::unique_ptr<EventLog> log;
+    {
+        std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+        log = std::move(eventLog);
+    }
+    log.reset(); // Joins the writer outside the store lock
+}
+
+// Prints the event log's segments, disk usage and group commits.
+void StompProtocol::printEventLogStatus() {
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    if (!eventLog) {
+        std::cout << "Event log: off" << std::endl;
+        return;
+    }
+    EventLog::Status status = eventLog->status();
+    std::cout << "Event log: " << eventLog->getDirectory() << ", " << status.segments << " segments, "
+              << status.diskBytes << " bytes on disk, " << status.appended << " records appended in "
+              << status.commits << " commits, " << status.compactions << " compactions" << std::endl;
+}
+
+// Writes the stored events of a channel, or of all channels for "*", as a columnar snapshot.
+void StompProtocol::writeSnapshot(const std::string& channel, const std::string& filePath) {
+    drainWorkers();
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    std::vector<const EventStore*> stores;
+    for (const std::unique_ptr<StoreShard>& shard : shards) {
+        stores.push_back(&shard->eventSummary);
+    }
+    std::vector<InternId> channels;
+    InternId channelId;
+    if (channel == "*") {
+        for (const EventStore* store : stores) {
+            for (const EventStore::ChannelUsage& usage : store->channelUsage()) {
+                channels.push_back(usage.channel);
+            }
+        }
+        std::sort(channels.begin(), channels.end(), [](InternId a, InternId b) {
+            return StringInterner::instance().lookup(a) < StringInterner::instance().lookup(b);
+        });
+    } else if (StringInterner::instance().find(channel, channelId) && shardOf(channelId).eventSummary.hasChannel(channelId)) {
+        channels.push_back(channelId);
+    }
+
+    size_t rows = 0;
+    if (!Snapshot::write(filePath, stores, channels, rows)) {
+        std::cerr << "Error: Could not write snapshot " << filePath << std::endl;
+        return;
+    }
+    std::cout << "Snapshot of " << rows << " events written to " << filePath << std::endl;
+}
+
+// Loads a snapshot written by writeSnapshot into the store.
+bool StompProtocol::loadSnapshot(const std::string& filePath) {
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    size_t rows = 0;
+    if (!Snapshot::load(filePath, shardRouter(), rows)) {
+        std::cerr << "Error: Could not load snapshot " << filePath << std::endl;
+        return false;
+    }
+    std::cout << "Loaded " << rows << " events from snapshot " << filePath << std::endl;
+    return true;
+}
+
+// Runs a filter/group-by query over one channel's stored events.
+void StompProtocol::runQuery(const std::string& text) {
+    Query query;
+    std::string error;
+    if (!Query::parse(text, query, error)) {
+        std::cerr << "Invalid query: " << error << std::endl;
+        return;
+    }
+
+    drainWorkers();
+    InternId channelId;
+    StoreShard& shard = StringInterner::instance().find(query.getChannel(), channelId) ? shardOf(channelId) : *shards[0];
+    std::lock_guard<std::mutex> lock(shard.storeMutex);
+    Query::Result result = query.run(shard.eventSummary);
+    std::cout << "Query on " << query.getChannel() << ": " << result.matched << " of " << result.scanned
+              << " events matched" << std::endl;
+    for (const std::pair<std::string, size_t>& group : result.groups) {
+        std::cout << Query::fieldName(query.getGroupBy()) << " " << group.first << ": " << group.second << std::endl;
+    }
+    std::cout << "Scanned " << result.scanned << " events in " << result.seconds * 1000 << " ms";
+    if (result.seconds > 0) {
+        std::cout << " (" << static_cast<long long>(result.scanned / result.seconds) << " events/s)";
+    }
+    std::cout << std::endl;
+}
+
+// Looks up events of a channel whose description, name or city contain all the terms.
+void StompProtocol::search(const std::string& channel, const std::string& terms) {
+    static const size_t MAX_PRINTED = 20;
+    std::vector<std::string> tokens;
+    TextIndex::tokenize(terms, tokens);
+    if (tokens.empty()) {
+        std::cerr << "search needs at least one word or number" << std::endl;
+        return;
+    }
+    drainWorkers();
+
+    InternId channelId;
+    bool known = StringInterner::instance().find(channel, channelId);
+    StoreShard& shard = known ? shardOf(channelId) : *shards[0];
+    std::lock_guard<std::mutex> lock(shard.storeMutex);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<const Event*> matches;
+    if (known) {
+        shard.eventSummary.search(channelId, tokens, [&matches](const Event& event) { matches.push_back(&event); });
+    }
+    double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Search " << channel << " for \"" << terms << "\": " << matches.size() << " matches in "
+              << micros << " us" << std::endl;
+    for (size_t i = 0; i < matches.size() && i < MAX_PRINTED; i++) {
+        const Event& event = *matches[i];
+        std::cout << DateFormatter::format(event.get_date_time()) << " " << event.get_city() << " - "
+                  << event.get_name() << " (" << event.getEventOwnerUser() << "): " << event.get_description().substr(0, 80)
+                  << std::endl;
+    }
+    if (matches.size() > MAX_PRINTED) {
+        std::cout << "... and " << matches.size() - MAX_PRINTED << " more" << std::endl;
+    }
+}
+
+void StompProtocol::printChannelStats(const std::string& channel) {
+    drainWorkers();
+    InternId channelId;
+    bool known = StringInterner::instance().find(channel, channelId);
+    StoreShard& shard = known ? shardOf(channelId) : *shards[0];
+    std::lock_guard<std::mutex> lock(shard.storeMutex);
+    const ChannelSketch *sketch = known ? shard.eventSummary.sketch(channelId) : nullptr;
+    if (sketch == nullptr) {
+        std::cout << "No events received on " << channel << std::endl;
+        return;
+    }
+
+    std::cout << "Channel " << channel << ": " << sketch->events() << " events received" << std::endl;
+    std::cout << "Distinct users: ~" << std::llround(sketch->distinctUsers()) << std::endl;
+    std::cout << "Distinct cities: ~" << std::llround(sketch->distinctCities()) << std::endl;
+    std::cout << "(typical error " << std::round(HyperLogLog::relativeError() * 1000) / 10 << "%)" << std::endl;
+    std::cout << "Top cities:" << std::endl;
+    for (const std::pair<InternId, std::uint32_t>& city : sketch->topCities()) {
+        std::cout << "  " << StringInterner::instance().lookup(city.first) << ": ~" << city.second << std::endl;
+    }
+}
+
+void StompProtocol::setLatencyTracking(bool enabled) {
+    latencyTracking.store(enabled, std::memory_order_relaxed);
+}
+
+bool StompProtocol::isLatencyTracking() const {
+    return latencyTracking.load(std::memory_order_relaxed);
+}
+
+void StompProtocol::printLatency(const std::string& channel) {
+    drainWorkers();
+    // Copies of the histograms by channel name, so output is sorted and no shard stays locked
+    std::map<std::string, LatencyHistogram> histograms;
+    {
+        std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+        for (std::unique_ptr<StoreShard>& shard : shards) {
+            for (const std::pair<const InternId, LatencyHistogram>& entry : shard->latency) {
+                const std::string& name = StringInterner::instance().lookup(entry.first);
+                if (channel.empty() || name == channel) {
+                    histograms.insert(std::make_pair(name, entry.second));
+                }
+            }
+        }
+    }
+    if (histograms.empty()) {
+        std::cout << "No timestamped messages received" << (channel.empty() ? "" : " on " + channel)
+                  << (isLatencyTracking() ? "" : " (latency tracking is off)") << std::endl;
+        return;
+    }
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    for (const std::pair<const std::string, LatencyHistogram>& entry : histograms) {
+        const LatencyHistogram& histogram = entry.second;
+        out << "Channel " << entry.first << ": " << histogram.count() << " messages, latency us: min "
+            << histogram.min() / 1e3 << ", mean " << histogram.mean() / 1e3
+            << ", p50 " << histogram.percentile(0.5) / 1e3 << ", p90 " << histogram.percentile(0.9) / 1e3
+            << ", p99 " << histogram.percentile(0.99) / 1e3 << ", p99.9 " << histogram.percentile(0.999) / 1e3
+            << ", max " << histogram.max() / 1e3 << "\n";
+        if (histogram.negatives() > 0) {
+            out << "  " << histogram.negatives() << " sent later than received, counted as 0 (sender clock ahead)\n";
+        }
+    }
+    std::cout << out.str() << std::flush;
+}
+
+void StompProtocol::resetLatency(const std::string& channel) {
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    for (std::unique_ptr<StoreShard>& shard : shards) {
+        if (channel.empty()) {
+            shard->latency.clear();
+            continue;
+        }
+        InternId channelId;
+        if (StringInterner::instance().find(channel, channelId)) {
+            shard->latency.erase(channelId);
+        }
+    }
+}
+
+void StompProtocol::setRollupWidth(long long seconds) {
+    std::vector<std::unique_lock<std::mutex>> locks = lockAllShards();
+    for (std::unique_ptr<StoreShard>& shard : shards) {
+        shard->eventSummary.setRollupWidth(seconds);
+    }
+}
+
+void StompProtocol::printRollup(const std::string& channel, const std::string& filePath) {
+    drainWorkers();
+    InternId channelId;
+    bool known = StringInterner::instance().find(channel, channelId);
+    StoreShard& shard = known ? shardOf(channelId) : *shards[0];
+    std::lock_guard<std::mutex> lock(shard.storeMutex);
+    const RollupTable *rollup = known ? shard.eventSummary.rollup(channelId) : nullptr;
+    if (rollup == nullptr) {
+        std::cout << "No events received on " << channel << std::endl;
+        return;
+    }
+
+    StringInterner &interner = StringInterner::instance();
+    if (!filePath.empty()) {
+        std::ofstream out(filePath.c_str());
+        out << "bucket_start,bucket_seconds,city,total,active,forces_arrival_at_scene\n";
+        rollup->forEach([&](long long start, InternId city, const RollupTable::Counts& counts) {
+            out << start << ',' << rollup->width() << ",\"" << interner.lookup(city) << "\"," << counts.total << ','
+                << counts.active << ',' << counts.forcesArrival << '\n';
+        });
+        out.close();
+        if (!out) {
+            std::cerr << "Error: Could not write rollup " << filePath << std::endl;
+            return;
+        }
+        std::cout << rollup->size() << " rollup rows of " << channel << " written to " << filePath << std::endl;
+        return;
+    }
+
+    std::cout << "Channel " << channel << " per " << rollup->width() << "s: bucket, city, total, active, forces arrival" << std::endl;
+    rollup->forEach([&](long long start, InternId city, const RollupTable::Counts& counts) {
+        std::cout << DateFormatter::format(static_cast<int>(start)) << "  " << interner.lookup(city) << ": "
+                  << counts.total << ", " << counts.active << ", " << counts.forcesArrival << std::endl;
+    });
 }
 
 // Stores the request type associated with a receipt ID.
 void StompProtocol::storeReceipt(int receiptId, const std::string& requestType) {
+    std::lock_guard<std::mutex> lock(receiptMutex);
     receiptMap[receiptId] = requestType;
+    receiptSentAt[receiptId] = Metrics::now();
+}
+
+// Waits until the server acknowledged the login (CONNECTED) and every request sent with a receipt.
+bool StompProtocol::waitForReceipts(long long timeoutMs) {
+    std::unique_lock<std::mutex> lock(receiptMutex);
+    receiptsChanged.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() {
+        return (isConnected() && receiptMap.empty()) || shouldStopCommunication();
+    });
+    return isConnected() && receiptMap.empty();
 }
 
 // Sends a CONNECT frame to initiate connection.
@@ -56,37 +499,54 @@ void StompProtocol::connect() {
 
 // Checks if the client is connected to the server.
 bool StompProtocol::isConnected() {
-    std::lock_guard<std::mutex> lock(connectionMutex);
-    return connected;
+    return connected.load(std::memory_order_acquire);
 }
 
 // Sets the connection status.
 void StompProtocol::setConnected(bool connected) {
-    std::lock_guard<std::mutex> lock(connectionMutex);
-    this->connected = connected;
+    this->connected.store(connected, std::memory_order_release);
 }
 
 // Check if an error occurred
 bool StompProtocol::hasErrorOccurred() { 
-    std::lock_guard<std::mutex> lock(errorMutex);
-    return errorOccured; 
+    return errorOccured.load(std::memory_order_acquire);
 } 
 // Check if the client is subscribed to a channel
 bool StompProtocol::hasSubscription(const std::string& channel) {
-    return subscriptionIds.find(channel) != subscriptionIds.end();
+    InternId channelId;
+    return StringInterner::instance().find(channel, channelId) && subscriptionIds.find(channelId) != subscriptionIds.end();
 }
 
-void StompProtocol::signalStopCommunication() { stopCommunication = true; } // Signal communication thread to stop
+// Signal communication threads to stop, and wake anyone waiting for receipts
+void StompProtocol::signalStopCommunication() {
+    stopCommunication.store(true, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(receiptMutex);
+    receiptsChanged.notify_all();
+}
 
-bool StompProtocol::shouldStopCommunication() const { return stopCommunication; } // Check stop flag
+// Check stop flag
+bool StompProtocol::shouldStopCommunication() const { return stopCommunication.load(std::memory_order_acquire); }
 
 // Sends a STOMP frame with given command, headers, and body.
 void StompProtocol::send(const std::string& command, const std::map<std::string, std::string>& headers, const std::string& body) {
-    if (!connected && command != "CONNECT") {
+    if (!connected.load(std::memory_order_acquire) && command != "CONNECT") {
         std::cerr << "Cannot send frame: Not connected to server!" << std::endl;
         return;
     }
 
+    std::uint64_t start = Metrics::now();
+    std::string frameStr = formatFrame(command, headers, body);
+
+    // std::cout << "Sending frame: " << frameStr << std::endl; // Add logging
+
+    // Send the frame to the server using the connection handler.
+    connectionHandler.sendFrameAscii(frameStr, '\0'); // Use sendFrameAscii to add the null character
+    Metrics::observe(Metrics::SEND, Metrics::nanosSince(start));
+}
+
+// Renders a STOMP frame, without the null terminator that sendFrameAscii adds.
+std::string StompProtocol::formatFrame(const std::string& command, const std::map<std::string, std::string>& headers,
+                                       const std::string& body) {
     std::stringstream frame;
     frame << command << "\n";
 
@@ -104,67 +564,135 @@ void StompProtocol::send(const std::string& command, const std::map<std::string,
         frame << "\n\0"; // Add STOMP null terminator.
     }
 
-    std::string frameStr = frame.str();
-
-    // std::cout << "Sending frame: " << frameStr << std::endl; // Add logging
-
-    // Send the frame to the server using the connection handler.
-    connectionHandler.sendFrameAscii(frameStr, '\0'); // Use sendFrameAscii to add the null character
+    return frame.str();
 }
 
 // Parses and processes an incoming STOMP frame from the server.
 void StompProtocol::parseFrame(const std::string& message) {
-    std::istringstream stream(message);
-    std::string line, command;
-    std::map<std::string, std::string> headers;
-    std::string body;
+    parseFrame(FrameRef(FrameBuffer::create(message.data(), message.size())));
+}
+
+// Routes a received frame: a MESSAGE goes to the worker owning its destination's shard, only
+// its headers are scanned here; every other frame is handled on the calling thread.
+void StompProtocol::parseFrame(const FrameRef& frame) {
+    StringRef message(frame->data(), frame->size());
+    if (workers && message.substr(0, message.find('\n')) == "MESSAGE") {
+        size_t position = message.find('\n') + 1;
+        while (position < message.size()) {
+            size_t lineEnd = message.find('\n', position);
+            StringRef line = message.substr(position, lineEnd - position);
+            if (line.empty() || lineEnd == std::string::npos) {
+                break;
+            }
+            if (line.size() > 12 && line.substr(0, 12) == "destination:") {
+                StringRef destination = line.substr(12);
+                InternId channel = StringInterner::instance().intern(destination.data(), destination.size());
+                Metrics::add(Metrics::WORKER_QUEUED); // Before dispatch, so the depth never reads negative
+                workers->dispatch(ChannelSketch::hash(channel) % shards.size(), frame);
+                return;
+            }
+            position = lineEnd + 1;
+        }
+        return; // No destination: handleMessage would drop it too
+    }
+    processFrame(frame);
+}
+
+// Parses a received frame in place: command, headers and body are views into the buffer.
+void StompProtocol::processFrame(const FrameRef& frame) {
+    std::uint64_t start = Metrics::now();
+    StringRef message(frame->data(), frame->size());
 
-    std::getline(stream, command); // Extracts the command (first line).
+    size_t lineEnd = message.find('\n');
+    StringRef command = message.substr(0, lineEnd); // Extracts the command (first line).
+    size_t position = lineEnd == std::string::npos ? message.size() : lineEnd + 1;
 
     // Extract headers until an empty line is encountered.
-    while (std::getline(stream, line) && !line.empty()) {
-        size_t delimiter = line.find(":");
+    FrameHeaders headers;
+    while (position < message.size()) {
+        lineEnd = message.find('\n', position);
+        StringRef line = message.substr(position, lineEnd - position);
+        position = lineEnd == std::string::npos ? message.size() : lineEnd + 1;
+        if (line.empty()) {
+            break;
+        }
+        size_t delimiter = line.find(':');
         if (delimiter != std::string::npos) {
-            headers[line.substr(0, delimiter)] = line.substr(delimiter + 1);
+            headers.add(line.substr(0, delimiter), line.substr(delimiter + 1));
         }
     }
 
-    std::getline(stream, body, '\0'); // Extracts body content (if any).
+    StringRef body = message.substr(position); // Extracts body content (if any).
 
     // Determine which handler to call based on the command type.
     if (command == "CONNECTED") {
         handleConnected();
     } else if (command == "MESSAGE") {
-        handleMessage(headers, body);
+        handleMessage(headers, frame, body);
     } else if (command == "ERROR") {
         handleError(headers, body);
     } else if (command == "RECEIPT") {
         handleReceipt(headers);
     }
+    Metrics::observe(Metrics::FRAME_PROCESSING, Metrics::nanosSince(start));
 }
 
 // Handles CONNECTED frame, confirming successful login.
 void StompProtocol::handleConnected() {
     setConnected(true);
     std::cout << "Login successful" << std::endl;
+
+    std::lock_guard<std::mutex> lock(receiptMutex);
+    receiptsChanged.notify_all(); // CONNECTED acknowledges the login
 }
 
 // Handles MESSAGE frames, extracting and storing received event information.
-void StompProtocol::handleMessage(const std::map<std::string, std::string>& headers, const std::string& body) {
-    std::string destination = headers.at("destination"); // Extracts topic destination.
-
-    // std::cout << "New message received in " << destination << ":\n" << body << std::endl;
+void StompProtocol::handleMessage(const FrameHeaders& headers, const FrameRef& frame, const StringRef& body) {
+    StringRef destinationName;
+    if (!headers.find("destination", destinationName)) {
+        return;
+    }
 
-    Event newEvent(body); // Parses the body as an Event object.
-    eventSummary[destination].push_back(newEvent); // Stores the event.
+    // Publish -> delivery latency, if tracking and the sender stamped the frame
+    long long latency = 0;
+    StringRef timestamp;
+    bool timed = latencyTracking.load(std::memory_order_relaxed) && headers.find("timestamp", timestamp);
+    if (timed) {
+        long long receivedAt = LatencyHistogram::now();
+        try {
+            latency = receivedAt - std::stoll(timestamp.str());
+        } catch (const std::exception&) {
+            timed = false;
+        }
+    }
+    InternId destination = StringInterner::instance().intern(destinationName.data(), destinationName.size()); // Extracts topic destination.
+
+    // Parses the body as an Event that keeps views into the frame, and moves it into the store.
+    // Only this thread writes the destination's shard; the lock is contended by commands alone.
+    Event event(frame, body);
+    StoreShard& shard = shardOf(destination);
+    std::lock_guard<std::mutex> lock(shard.storeMutex);
+    if (eventLog) {
+        eventLog->append(destination, event); // Group-committed by the log's writer thread
+    }
+    if (timed) {
+        shard.latency[destination].record(latency);
+    }
+    shard.eventSummary.add(destination, std::move(event));
+    Metrics::add(Metrics::EVENTS_STORED);
 }
 
 // Handles ERROR frames by displaying error details.
-void StompProtocol::handleError(const std::map<std::string, std::string>& headers, const std::string& body) {
+void StompProtocol::handleError(const FrameHeaders& headers, const StringRef& body) {
     std::cerr << "\nERROR received from server:\n";
 
-    for (std::map<std::string, std::string>::const_iterator it = headers.begin(); 
-        it != headers.end(); ++it) {
+    // Print headers sorted by key, as the server sent them into a map.
+    std::map<std::string, std::string> sortedHeaders;
+    for (size_t i = 0; i < headers.size(); i++) {
+        sortedHeaders[headers.key(i).str()] = headers.value(i).str();
+    }
+    for (std::map<std::string, std::string>::const_iterator it = sortedHeaders.begin(); 
+        it != sortedHeaders.end(); ++it) {
         const std::string& key = it->first;
         const std::string& value = it->second;
         std::cerr << key << ": " << value << std::endl;
@@ -172,23 +700,31 @@ void StompProtocol::handleError(const std::map<std::string, std::string>& header
 
     std::cerr << body << std::endl;
 
-    // Signal communication thread to stop
+    // Record the error, then signal communication threads to stop (the release publishes both)
+    errorOccured.store(true, std::memory_order_relaxed);
     signalStopCommunication();
-
-    // Mutex scope starts here
-    std::lock_guard<std::mutex> lock(errorMutex);
-    errorOccured = true;
-    // Mutex scope ends here
 }
 
 // Handles RECEIPT frames by confirming successful message delivery.
-void StompProtocol::handleReceipt(const std::map<std::string, std::string>& headers) {
-    if (headers.find("receipt-id") != headers.end()) {
-        int receiptId = std::stoi(headers.at("receipt-id"));
+void StompProtocol::handleReceipt(const FrameHeaders& headers) {
+    StringRef receiptHeader;
+    if (headers.find("receipt-id", receiptHeader)) {
+        int receiptId = std::stoi(receiptHeader.str());
 
         // Check if we stored this receipt ID
-        if (receiptMap.find(receiptId) != receiptMap.end()) {
-            std::string requestType = receiptMap[receiptId];
+        std::string requestType;
+        bool found = false;
+        {
+            std::lock_guard<std::mutex> lock(receiptMutex);
+            std::unordered_map<int, std::string>::iterator it = receiptMap.find(receiptId);
+            if (it != receiptMap.end()) {
+                requestType = it->second;
+                found = true;
+                Metrics::observe(Metrics::RECEIPT_LATENCY, Metrics::nanosSince(receiptSentAt[receiptId]));
+            }
+        }
+        if (found) {
+            Metrics::add(Metrics::RECEIPTS);
               if (requestType == "Logout") {
 
                 std::cout << "Logged out" << std::endl;
@@ -200,8 +736,11 @@ void StompProtocol::handleReceipt(const std::map<std::string, std::string>& head
                 std::cout << requestType << std::endl;
             }
 
-            // Remove from map since it's processed
+            // Remove from map since it's processed, after printing so waiters see the output first
+            std::lock_guard<std::mutex> lock(receiptMutex);
             receiptMap.erase(receiptId);
+            receiptSentAt.erase(receiptId);
+            receiptsChanged.notify_all();
         } else {
             std::cout << "Received an unknown RECEIPT ID: " << receiptId << std::endl;
         }
@@ -211,82 +750,61 @@ void StompProtocol::handleReceipt(const std::map<std::string, std::string>& head
 }
 // Converts an epoch timestamp into a formatted date-time string.
 std::string StompProtocol::epochToDate(int epochTime) const {
-    std::time_t time = static_cast<std::time_t>(epochTime);
-    std::tm *tm = std::localtime(&time);
-    std::ostringstream oss;
-    oss << std::put_time(tm, "%d/%m/%y %H:%M");
-    return oss.str();
+    return DateFormatter::format(epochTime);
 }
 
 
 // Method to generate summary output 
-void StompProtocol::summarizeEmergencyChannel(const std::string& channel, const std::string& user, const std::string& filePath) {
-    // Relevant events for the user
-    std::vector<Event> relevantEvents;
+void StompProtocol::summarizeEmergencyChannel(const std::string& channel, const std::string& user, const std::string& filePath,
+                                              long long from, long long to) {
+    // Relevant events for the user (pointers into eventSummary, nothing is copied).
+    // The channel's shard stays locked until the file is written, so the pointers remain valid.
+    drainWorkers();
+    InternId channelId, userId;
+    StringInterner &interner = StringInterner::instance();
+    bool known = interner.find(channel, channelId);
+    StoreShard& shard = known ? shardOf(channelId) : *shards[0];
+    std::lock_guard<std::mutex> lock(shard.storeMutex);
+    std::vector<const Event*> relevantEvents;
 
     int activeCount = 0;  // Count of 'true' active
     int forcesArrivalCount = 0;  // Count of 'true' forces_arrival_at_scene
 
-    // Check if the channel exists and filter events by user
-    if (eventSummary.find(channel) != eventSummary.end()) {
-        for (const Event& event : eventSummary[channel]) {
-            if (event.getEventOwnerUser() == user) {
-                relevantEvents.push_back(event);
-
-                // Check for 'active' and 'forces_arrival_at_scene' in general_information
-                const auto& generalInfo = event.get_general_information();
-                if (generalInfo.find("active") != generalInfo.end() && generalInfo.at("active") == "true") {
-                    activeCount++;
-                }
-                if (generalInfo.find("forces_arrival_at_scene") != generalInfo.end() && generalInfo.at("forces_arrival_at_scene") == "true") {
-                    forcesArrivalCount++;
-                }
+    // Check if the channel exists and filter events by user (interned IDs compare as integers)
+    bool windowed = from != LLONG_MIN || to != LLONG_MAX;
+    if (known && interner.find(user, userId)) {
+        // The full history is cached per (channel, user) and only re-rendered when it changed
+        if (!windowed) {
+            SummaryCache::Outcome outcome;
+            if (!shard.summaryCache.write(shard.eventSummary, channel, channelId, userId, filePath, outcome)) {
+                std::cerr << "Error: Could not open file " << filePath << " for writing." << std::endl;
+                return;
             }
+            std::cout << "Summary successfully written to " << filePath << std::endl;
+            return;
         }
-    }
 
-    // Open file for writing (overwrite mode)
-    std::ofstream outFile(filePath);
-    if (!outFile) {
-        std::cerr << "Error: Could not open file " << filePath << " for writing." << std::endl;
-        return;
-    }
-
-    // Print header with missing stats
-    outFile << "Channel " << channel << "\n";
-    outFile << "Stats:\n";
-    outFile << "Total: " << relevantEvents.size() << "\n";
-    outFile << "active: " << activeCount << "\n";
-    outFile << "forces arrival at scene: " << forcesArrivalCount << "\n\n";
-
-    // Print event reports header
-    outFile << "\nEvent Reports:\n\n";
+        // A window is served by the channel's time index
+        shard.eventSummary.forEachInRange(channelId, from, to, [&](const Event& event) {
+            if (event.getEventOwnerUserId() == userId) {
+                relevantEvents.push_back(&event);
 
-    if (!relevantEvents.empty()) {
-        // Sort events by date_time, then by name lexicographically
-        std::sort(relevantEvents.begin(), relevantEvents.end(), [](const Event& a, const Event& b) {
-            // Sort lexicographically if time is the same
-            if (a.get_date_time() == b.get_date_time()) {
-                return a.get_name() < b.get_name();
+                // Check for 'active' and 'forces_arrival_at_scene' in general_information (bit tests)
+                const GeneralInformation& generalInfo = event.get_general_information();
+                activeCount += generalInfo.isTrue(GeneralInformation::ACTIVE);
+                forcesArrivalCount += generalInfo.isTrue(GeneralInformation::FORCES_ARRIVAL_AT_SCENE);
             }
-            // Sort by time if time is different
-            return a.get_date_time() < b.get_date_time();
         });
+    }
 
-        // Set description to be 27 chars max
-        for (size_t i = 0; i < relevantEvents.size(); i++) {
-            const Event& event = relevantEvents[i];
-            std::string shortDescription = event.get_description().substr(0, 27);
-            if (event.get_description().length() > 30) {
-                shortDescription += "...";
-            }
+    // Sort events by date_time, then by name lexicographically
+    std::sort(relevantEvents.begin(), relevantEvents.end(), SummaryWriter::before);
 
-            outFile << "\nReport_" << (i + 1) << ":\n";
-            outFile << "\tcity: " << event.get_city() << "\n";
-            outFile << "\tdate time: " << epochToDate(event.get_date_time()) << "\n";
-            outFile << "\tevent name: " << event.get_name() << "\n";
-            outFile << "\tsummary: " << shortDescription << "\n";
-        }
+    // Render the header and reports into buffers and write them to the file (overwrite mode)
+    SummaryWriter writer(channel, activeCount, forcesArrivalCount);
+    if (!writer.write(filePath, relevantEvents)) {
+        std::cerr << "Error: Could not open file " << filePath << " for writing." << std::endl;
+        return;
     }
 
     std::cout << "Summary successfully written to " << filePath << std::endl;
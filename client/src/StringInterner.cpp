@@ -0,0 +1,134 @@
+#include "../include/StringInterner.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const std::size_t INITIAL_SLOTS = 1024; // Power of two
+
+// FNV-1a, good enough for short names.
+std::uint64_t hashBytes(const char *data, std::size_t length) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (std::size_t i = 0; i < length; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+const unsigned StringInterner::BLOCK_BITS;
+const std::size_t StringInterner::BLOCK_SIZE;
+const std::size_t StringInterner::MAX_BLOCKS;
+
+StringInterner &StringInterner::instance() {
+    static StringInterner interner;
+    return interner;
+}
+
+StringInterner::StringInterner() :
+    blocks(new std::atomic<std::string *>[MAX_BLOCKS]),
+    count(0),
+    mutex(),
+    slots(INITIAL_SLOTS, 0),
+    stringBytes(0) {
+    for (std::size_t i = 0; i < MAX_BLOCKS; i++) {
+        blocks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+StringInterner::~StringInterner() {
+    for (std::size_t i = 0; i < MAX_BLOCKS; i++) {
+        delete[] blocks[i].load(std::memory_order_relaxed);
+    }
+    delete[] blocks;
+}
+
+// Returns the slot holding the string, or the empty slot where it belongs.
+std::size_t StringInterner::probe(const char *data, std::size_t length, std::uint64_t hash) const {
+    std::size_t mask = slots.size() - 1;
+    std::size_t index = static_cast<std::size_t>(hash) & mask;
+    while (slots[index] != 0) {
+        const std::string &candidate = lookup(slots[index] - 1);
+        if (candidate.size() == length && std::memcmp(candidate.data(), data, length) == 0) {
+            break;
+        }
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+void StringInterner::grow() {
+    std::vector<std::uint32_t> old;
+    old.swap(slots);
+    slots.assign(old.size() * 2, 0);
+    for (std::uint32_t entry : old) {
+        if (entry != 0) {
+            const std::string &value = lookup(entry - 1);
+            slots[probe(value.data(), value.size(), hashBytes(value.data(), value.size()))] = entry;
+        }
+    }
+}
+
+InternId StringInterner::intern(const std::string &value) {
+    return intern(value.data(), value.size());
+}
+
+InternId StringInterner::intern(const char *data, std::size_t length) {
+    std::uint64_t hash = hashBytes(data, length);
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::size_t index = probe(data, length, hash);
+    if (slots[index] != 0) {
+        return slots[index] - 1;
+    }
+
+    std::uint32_t id = count.load(std::memory_order_relaxed);
+    std::size_t block = id >> BLOCK_BITS;
+    if (block >= MAX_BLOCKS) {
+        throw std::length_error("StringInterner is full");
+    }
+    std::string *storage = blocks[block].load(std::memory_order_relaxed);
+    if (storage == nullptr) {
+        storage = new std::string[BLOCK_SIZE];
+        blocks[block].store(storage, std::memory_order_release);
+    }
+    std::string &slot = storage[id & (BLOCK_SIZE - 1)];
+    slot.assign(data, length);
+    if (slot.capacity() > 15) {
+        stringBytes += slot.capacity() + 1; // Outside the small-string buffer
+    }
+    count.store(id + 1, std::memory_order_release); // Publish before the ID escapes
+
+    slots[index] = id + 1;
+    if ((id + 1) * 4 > slots.size() * 3) { // Keep the load factor under 3/4
+        grow();
+    }
+    return id;
+}
+
+bool StringInterner::find(const std::string &value, InternId &id) const {
+    std::uint64_t hash = hashBytes(value.data(), value.size());
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t index = probe(value.data(), value.size(), hash);
+    if (slots[index] == 0) {
+        return false;
+    }
+    id = slots[index] - 1;
+    return true;
+}
+
+const std::string &StringInterner::lookup(InternId id) const {
+    return blocks[id >> BLOCK_BITS].load(std::memory_order_acquire)[id & (BLOCK_SIZE - 1)];
+}
+
+std::size_t StringInterner::size() const {
+    return count.load(std::memory_order_acquire);
+}
+
+std::size_t StringInterner::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t usedBlocks = (count.load(std::memory_order_relaxed) + BLOCK_SIZE - 1) >> BLOCK_BITS;
+    return usedBlocks * BLOCK_SIZE * sizeof(std::string) + stringBytes + slots.size() * sizeof(std::uint32_t);
+}
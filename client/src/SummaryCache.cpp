@@ -0,0 +1,153 @@
+#include "../include/SummaryCache.h"
+#include "../include/SummaryWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const std::size_t SummaryCache::MAX_ENTRIES;
+
+SummaryCache::SummaryCache() : entries(), useClock(0) {}
+
+void SummaryCache::count(const Event &event, Entry &entry) {
+    const GeneralInformation &generalInfo = event.get_general_information();
+    entry.activeCount += generalInfo.isTrue(GeneralInformation::ACTIVE);
+    entry.forcesArrivalCount += generalInfo.isTrue(GeneralInformation::FORCES_ARRIVAL_AT_SCENE);
+}
+
+void SummaryCache::rebuild(const EventStore &store, InternId channelId, InternId userId, Entry &entry) {
+    entry.events.clear();
+    entry.activeCount = 0;
+    entry.forcesArrivalCount = 0;
+    store.forEach(channelId, [&](const Event &event) {
+        if (event.getEventOwnerUserId() == userId) {
+            entry.events.push_back(&event);
+            count(event, entry);
+        }
+    });
+    std::sort(entry.events.begin(), entry.events.end(), SummaryWriter::before);
+    entry.reports.clear();
+    SummaryWriter::appendReportsParallel(entry.reports, entry.events, 0, entry.events.size());
+}
+
+// Adds the user's events that arrived since the entry was built. Returns false, leaving the
+// entry unchanged, if one of them sorts before an existing report.
+bool SummaryCache::append(const EventStore &store, InternId channelId, InternId userId, Entry &entry) {
+    std::vector<const Event *> added;
+    store.forEachSince(channelId, entry.endSeq, [&](const Event &event) {
+        if (event.getEventOwnerUserId() == userId) {
+            added.push_back(&event);
+        }
+    });
+    std::sort(added.begin(), added.end(), SummaryWriter::before);
+    if (!added.empty() && !entry.events.empty() && SummaryWriter::before(added.front(), entry.events.back())) {
+        return false;
+    }
+
+    std::size_t begin = entry.events.size();
+    for (const Event *event : added) {
+        entry.events.push_back(event);
+        count(*event, entry);
+    }
+    SummaryWriter::appendReportsParallel(entry.reports, entry.events, begin, entry.events.size());
+    return true;
+}
+
+bool SummaryCache::fileMatches(const Entry &entry, const std::string &filePath) {
+    struct stat info;
+    return entry.filePath == filePath && ::stat(filePath.c_str(), &info) == 0 &&
+           static_cast<std::size_t>(info.st_size) == entry.fileBytes;
+}
+
+namespace {
+
+bool writeAt(int fd, const char *data, std::size_t length, off_t offset) {
+    while (length > 0) {
+        ssize_t written = ::pwrite(fd, data, length, offset);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= static_cast<std::size_t>(written);
+        offset += written;
+    }
+    return true;
+}
+
+} // namespace
+
+// Rewrites the header and appends the reports added since the last write, leaving the rest of
+// the file alone. Only valid when the file is the entry's and the header kept its length.
+bool SummaryCache::patchFile(const Entry &entry, const std::string &header, std::size_t reportsBefore) {
+    int fd = ::open(entry.filePath.c_str(), O_WRONLY);
+    if (fd < 0) return false;
+    bool written = writeAt(fd, header.data(), header.size(), 0) &&
+                   writeAt(fd, entry.reports.data() + reportsBefore, entry.reports.size() - reportsBefore,
+                           static_cast<off_t>(entry.fileBytes));
+    return ::close(fd) == 0 && written;
+}
+
+void SummaryCache::evictLeastRecent() {
+    std::map<std::pair<InternId, InternId>, Entry>::iterator oldest = entries.begin();
+    for (std::map<std::pair<InternId, InternId>, Entry>::iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->second.lastUse < oldest->second.lastUse) oldest = it;
+    }
+    entries.erase(oldest);
+}
+
+bool SummaryCache::write(const EventStore &store, const std::string &channel, InternId channelId, InternId userId,
+                         const std::string &filePath, Outcome &outcome) {
+    std::pair<InternId, InternId> key(channelId, userId);
+    std::map<std::pair<InternId, InternId>, Entry>::iterator it = entries.find(key);
+    bool found = it != entries.end();
+    if (!found) {
+        if (entries.size() >= MAX_ENTRIES) evictLeastRecent();
+        it = entries.insert(std::make_pair(key, Entry())).first;
+    }
+    Entry &entry = it->second;
+    entry.lastUse = ++useClock;
+
+    std::uint64_t userVersion = store.userVersion(channelId, userId);
+    std::uint64_t removalVersion = store.removalVersion(channelId);
+    bool sameFile = found && fileMatches(entry, filePath);
+    std::size_t reportsBefore = entry.reports.size();
+    if (found && removalVersion == entry.removalVersion && userVersion == entry.userVersion) {
+        outcome = UNCHANGED;
+        if (sameFile) return true;
+    } else if (found && removalVersion == entry.removalVersion && append(store, channelId, userId, entry)) {
+        outcome = APPENDED;
+    } else {
+        rebuild(store, channelId, userId, entry);
+        outcome = REBUILT;
+    }
+    entry.userVersion = userVersion;
+    entry.removalVersion = removalVersion;
+    entry.endSeq = store.endSeq(channelId);
+
+    SummaryWriter writer(channel, entry.activeCount, entry.forcesArrivalCount);
+    std::string header;
+    writer.appendHeader(header, entry.events.size());
+    bool written;
+    if (outcome == APPENDED && sameFile && header.size() == entry.headerBytes) {
+        written = patchFile(entry, header, reportsBefore);
+    } else {
+        std::vector<const std::string *> buffers;
+        buffers.push_back(&header);
+        buffers.push_back(&entry.reports);
+        written = SummaryWriter::writeBuffers(filePath, buffers);
+    }
+    if (!written) {
+        entry.filePath.clear();
+        return false;
+    }
+    entry.filePath = filePath;
+    entry.headerBytes = header.size();
+    entry.fileBytes = header.size() + entry.reports.size();
+    return true;
+}
+
+void SummaryCache::clear() {
+    entries.clear();
+}
@@ -0,0 +1,170 @@
+#include "../include/SummaryWriter.h"
+#include "../include/DateFormatter.h"
+#include <algorithm>
+#include <thread>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+namespace {
+
+const std::size_t REPORT_SIZE_ESTIMATE = 160; // Typical bytes per rendered report
+const int MAX_IOVECS = 16;                    // Header plus MAX_CHUNKS fits comfortably
+
+// Writes all buffers in order with as few writev calls as possible.
+bool writeAll(int fd, const std::vector<const std::string *> &buffers) {
+    std::vector<struct iovec> vectors;
+    for (const std::string *buffer : buffers) {
+        if (!buffer->empty()) {
+            struct iovec vector;
+            vector.iov_base = const_cast<char *>(buffer->data());
+            vector.iov_len = buffer->size();
+            vectors.push_back(vector);
+        }
+    }
+
+    std::size_t next = 0;
+    while (next < vectors.size()) {
+        int count = static_cast<int>(std::min<std::size_t>(vectors.size() - next, MAX_IOVECS));
+        ssize_t written = ::writev(fd, &vectors[next], count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        // Skip fully written buffers and advance into a partially written one.
+        std::size_t remaining = static_cast<std::size_t>(written);
+        while (next < vectors.size() && remaining >= vectors[next].iov_len) {
+            remaining -= vectors[next].iov_len;
+            next++;
+        }
+        if (remaining > 0) {
+            vectors[next].iov_base = static_cast<char *>(vectors[next].iov_base) + remaining;
+            vectors[next].iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+const std::size_t SummaryWriter::PARALLEL_THRESHOLD;
+const std::size_t SummaryWriter::MAX_CHUNKS;
+
+SummaryWriter::SummaryWriter(const std::string &channel, int activeCount, int forcesArrivalCount) :
+    channel(channel),
+    activeCount(activeCount),
+    forcesArrivalCount(forcesArrivalCount) {}
+
+void SummaryWriter::appendDecimal(std::string &out, unsigned long long value) {
+    char digits[20];
+    int length = 0;
+    do {
+        digits[length++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (length > 0) {
+        out.push_back(digits[--length]);
+    }
+}
+
+void SummaryWriter::appendHeader(std::string &out, std::size_t total) const {
+    out.append("Channel ").append(channel).append("\n");
+    out.append("Stats:\n");
+    out.append("Total: ");
+    appendDecimal(out, total);
+    out.append("\nactive: ");
+    appendDecimal(out, static_cast<unsigned long long>(activeCount));
+    out.append("\nforces arrival at scene: ");
+    appendDecimal(out, static_cast<unsigned long long>(forcesArrivalCount));
+    out.append("\n\n");
+    out.append("\nEvent Reports:\n\n");
+}
+
+void SummaryWriter::appendReports(std::string &out, const std::vector<const Event *> &events, std::size_t begin, std::size_t end) {
+    char date[DateFormatter::LENGTH];
+    for (std::size_t i = begin; i < end; i++) {
+        const Event &event = *events[i];
+        StringRef description = event.get_description();
+
+        out.append("\nReport_");
+        appendDecimal(out, i + 1);
+        out.append(":\n\tcity: ").append(event.get_city());
+        DateFormatter::format(event.get_date_time(), date);
+        out.append("\n\tdate time: ").append(date, DateFormatter::LENGTH);
+        out.append("\n\tevent name: ").append(event.get_name());
+        // Description is cut to 27 chars, and "..." is added only when it was longer than 30.
+        out.append("\n\tsummary: ").append(description.data(), std::min<std::size_t>(description.size(), 27));
+        if (description.length() > 30) {
+            out.append("...");
+        }
+        out.push_back('\n');
+    }
+}
+
+bool SummaryWriter::writeBuffers(const std::string &filePath, const std::vector<const std::string *> &buffers) {
+    int fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    bool written = writeAll(fd, buffers);
+    return ::close(fd) == 0 && written;
+}
+
+void SummaryWriter::formatChunks(const std::vector<const Event *> &events, std::size_t begin, std::size_t end,
+                                 std::vector<std::string> &chunks) {
+    // Small ranges are formatted on the calling thread, big ones in ordered parallel chunks.
+    std::size_t count = end - begin;
+    std::size_t chunkCount = 1;
+    if (count >= PARALLEL_THRESHOLD) {
+        chunkCount = std::max(1u, std::thread::hardware_concurrency());
+        chunkCount = std::min(chunkCount, MAX_CHUNKS);
+    }
+    std::size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    chunks.assign(chunkCount, std::string());
+    std::vector<std::thread> workers;
+    for (std::size_t c = 0; c < chunkCount; c++) {
+        std::size_t chunkBegin = std::min(end, begin + c * chunkSize);
+        std::size_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+        std::string &chunk = chunks[c];
+        chunk.reserve((chunkEnd - chunkBegin) * REPORT_SIZE_ESTIMATE);
+        if (c + 1 == chunkCount) {
+            appendReports(chunk, events, chunkBegin, chunkEnd); // Last chunk runs on this thread
+        } else {
+            workers.push_back(std::thread([&chunk, &events, chunkBegin, chunkEnd]() {
+                appendReports(chunk, events, chunkBegin, chunkEnd);
+            }));
+        }
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+void SummaryWriter::appendReportsParallel(std::string &out, const std::vector<const Event *> &events, std::size_t begin, std::size_t end) {
+    if (end - begin < PARALLEL_THRESHOLD) {
+        appendReports(out, events, begin, end);
+        return;
+    }
+    std::vector<std::string> chunks;
+    formatChunks(events, begin, end, chunks);
+    for (const std::string &chunk : chunks) {
+        out.append(chunk);
+    }
+}
+
+bool SummaryWriter::write(const std::string &filePath, const std::vector<const Event *> &events) const {
+    std::string header;
+    appendHeader(header, events.size());
+
+    std::vector<std::string> chunks;
+    formatChunks(events, 0, events.size(), chunks);
+
+    std::vector<const std::string *> buffers;
+    buffers.push_back(&header);
+    for (const std::string &chunk : chunks) {
+        buffers.push_back(&chunk);
+    }
+    return writeBuffers(filePath, buffers);
+}
@@ -0,0 +1,183 @@
+#include "../include/TextIndex.h"
+#include <algorithm>
+
+namespace {
+
+const std::size_t TERM_OVERHEAD = 64; // Map node, key and Postings header, roughly
+
+bool isTokenChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+char lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+void putVarint(std::vector<std::uint8_t> &out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+std::uint64_t getVarint(const std::vector<std::uint8_t> &in, std::size_t &position) {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; ; shift += 7) {
+        std::uint8_t byte = in[position++];
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return value;
+    }
+}
+
+} // namespace
+
+const std::size_t TextIndex::SKIP_INTERVAL;
+const std::size_t TextIndex::MAX_TOKEN;
+
+// Walks one postings list in ascending order.
+class TextIndex::Cursor
+{
+public:
+    explicit Cursor(const Postings &postings) : postings(&postings), index(0), position(0), current(0), done(postings.count == 0) {
+        if (!done) current = getVarint(postings.bytes, position);
+    }
+
+    bool atEnd() const { return done; }
+    std::uint64_t value() const { return current; }
+
+    void next() {
+        if (++index >= postings->count) {
+            done = true;
+            return;
+        }
+        current += getVarint(postings->bytes, position);
+    }
+
+    // Moves to the first posting >= target, jumping through skip entries first.
+    void advanceTo(std::uint64_t target) {
+        if (done || current >= target) return;
+        const std::vector<Skip> &skips = postings->skips;
+        std::vector<Skip>::const_iterator skip = std::upper_bound(skips.begin(), skips.end(), target,
+            [](std::uint64_t seq, const Skip &entry) { return seq < entry.seq; });
+        if (skip != skips.begin() && (skip - 1)->index > index) {
+            --skip;
+            index = skip->index;
+            current = skip->seq;
+            position = skip->offset;
+        }
+        while (!done && current < target) {
+            next();
+        }
+    }
+
+private:
+    const Postings *postings;
+    std::uint32_t index;
+    std::size_t position; // Byte offset after the current posting
+    std::uint64_t current;
+    bool done;
+};
+
+void TextIndex::Postings::append(std::uint64_t seq) {
+    if (count > 0 && seq == last) return; // Token repeated within one event
+    putVarint(bytes, count == 0 ? seq : seq - last);
+    if (count % SKIP_INTERVAL == 0 && count > 0) {
+        skips.push_back(Skip{seq, count, static_cast<std::uint32_t>(bytes.size())});
+    }
+    last = seq;
+    count++;
+}
+
+TextIndex::TextIndex() : terms(), bytes(0), token() {}
+
+void TextIndex::tokenize(const StringRef &text, std::vector<std::string> &tokens) {
+    const char *data = text.data();
+    std::size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !isTokenChar(data[i])) i++;
+        std::string value;
+        while (i < text.size() && isTokenChar(data[i])) {
+            if (value.size() < MAX_TOKEN) value.push_back(lower(data[i]));
+            i++;
+        }
+        if (!value.empty()) tokens.push_back(value);
+    }
+}
+
+void TextIndex::add(std::uint64_t seq, const StringRef &text) {
+    const char *data = text.data();
+    std::size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !isTokenChar(data[i])) i++;
+        token.clear();
+        while (i < text.size() && isTokenChar(data[i])) {
+            if (token.size() < MAX_TOKEN) token.push_back(lower(data[i]));
+            i++;
+        }
+        if (!token.empty()) addToken(seq);
+    }
+}
+
+void TextIndex::addToken(std::uint64_t seq) {
+    std::unordered_map<std::string, Postings>::iterator it = terms.find(token);
+    if (it == terms.end()) {
+        it = terms.insert(std::make_pair(token, Postings())).first;
+        bytes += TERM_OVERHEAD + token.size();
+    }
+    Postings &postings = it->second;
+    std::size_t before = postings.bytes.size() + postings.skips.size() * sizeof(Skip);
+    postings.append(seq);
+    bytes += postings.bytes.size() + postings.skips.size() * sizeof(Skip) - before;
+}
+
+std::vector<std::uint64_t> TextIndex::search(const std::vector<std::string> &queryTerms) const {
+    std::vector<std::uint64_t> matches;
+    std::vector<const Postings *> lists;
+    for (const std::string &term : queryTerms) {
+        std::unordered_map<std::string, Postings>::const_iterator it = terms.find(term);
+        if (it == terms.end()) return matches; // A term nobody used: no event has all of them
+        lists.push_back(&it->second);
+    }
+    if (lists.empty()) return matches;
+
+    // Drive the intersection with the rarest term, the others only jump forward.
+    std::sort(lists.begin(), lists.end(), [](const Postings *a, const Postings *b) { return a->count < b->count; });
+    std::vector<Cursor> cursors;
+    for (const Postings *list : lists) {
+        cursors.push_back(Cursor(*list));
+    }
+    for (Cursor &driver = cursors[0]; !driver.atEnd(); driver.next()) {
+        std::uint64_t seq = driver.value();
+        bool all = true;
+        for (std::size_t i = 1; i < cursors.size(); i++) {
+            cursors[i].advanceTo(seq);
+            if (cursors[i].atEnd()) return matches;
+            if (cursors[i].value() != seq) {
+                all = false;
+                break;
+            }
+        }
+        if (all) matches.push_back(seq);
+    }
+    return matches;
+}
+
+void TextIndex::prune(std::uint64_t firstSeq) {
+    bytes = 0;
+    for (std::unordered_map<std::string, Postings>::iterator it = terms.begin(); it != terms.end();) {
+        Postings &postings = it->second;
+        if (postings.count > 0 && postings.last < firstSeq) {
+            it = terms.erase(it);
+            continue;
+        }
+        Postings kept;
+        for (Cursor cursor(postings); !cursor.atEnd(); cursor.next()) {
+            if (cursor.value() >= firstSeq) kept.append(cursor.value());
+        }
+        kept.bytes.shrink_to_fit();
+        postings = std::move(kept);
+        bytes += TERM_OVERHEAD + it->first.size() + postings.bytes.size() + postings.skips.size() * sizeof(Skip);
+        ++it;
+    }
+}
@@ -0,0 +1,29 @@
+#include "../include/TimerWheel.h"
+
+TimerWheel::TimerWheel(std::size_t slotCount, long long granularity) :
+    slots(slotCount),
+    granularity(granularity > 0 ? granularity : 1),
+    currentTick(0),
+    started(false),
+    count(0) {}
+
+void TimerWheel::reset(long long newGranularity) {
+    for (std::vector<Entry> &slot : slots) {
+        std::vector<Entry>().swap(slot);
+    }
+    granularity = newGranularity > 0 ? newGranularity : 1;
+    started = false;
+    count = 0;
+}
+
+long long TimerWheel::tickOf(long long time) const {
+    long long tick = time / granularity;
+    return (time % granularity != 0 && time < 0) ? tick - 1 : tick;
+}
+
+void TimerWheel::schedule(const Entry &entry) {
+    long long size = static_cast<long long>(slots.size());
+    long long tick = tickOf(entry.expiry);
+    slots[static_cast<std::size_t>(((tick % size) + size) % size)].push_back(entry);
+    count++;
+}
@@ -5,18 +5,28 @@
 #include <string>
 #include <map>
 #include <vector>
-#include <sstream>
 #include <cstring>
-
-#include "../include/keyboardInput.h"
+#include <cctype>
 
 using namespace std;
 using json = nlohmann::json;
 
 Event::Event(std::string channel_name, std::string city, std::string name, int date_time,
-             std::string description, std::map<std::string, std::string> general_information)
-    : channel_name(channel_name), city(city), name(name),
-      date_time(date_time), description(description), general_information(general_information), eventOwnerUser("")
+             std::string description, GeneralInformation general_information)
+    : channel_name(StringInterner::instance().intern(channel_name)), city(StringInterner::instance().intern(city)),
+      name(StringInterner::instance().intern(name)), date_time(date_time),
+      frame(FrameBuffer::create(description.data(), description.size())), descriptionOffset(0),
+      descriptionLength(static_cast<std::uint32_t>(description.size())),
+      general_information(std::move(general_information)), eventOwnerUser(StringInterner::instance().intern(""))
+{
+}
+
+Event::Event(InternId channel_name, InternId city, InternId name, int date_time, const FrameRef &frame,
+             const StringRef &description, GeneralInformation general_information, InternId eventOwnerUser)
+    : channel_name(channel_name), city(city), name(name), date_time(date_time), frame(frame),
+      descriptionOffset(static_cast<std::uint32_t>(description.data() - frame->data())),
+      descriptionLength(static_cast<std::uint32_t>(description.size())),
+      general_information(std::move(general_information)), eventOwnerUser(eventOwnerUser)
 {
 }
 
@@ -25,24 +35,43 @@ Event::~Event()
 }
 
 void Event::setEventOwnerUser(std::string setEventOwnerUser) {
-    eventOwnerUser = setEventOwnerUser;
+    eventOwnerUser = StringInterner::instance().intern(setEventOwnerUser);
 }
 
 const std::string &Event::getEventOwnerUser() const {
+    return StringInterner::instance().lookup(eventOwnerUser);
+}
+
+InternId Event::getEventOwnerUserId() const {
     return eventOwnerUser;
 }
 
 const std::string &Event::get_channel_name() const
+{
+    return StringInterner::instance().lookup(this->channel_name);
+}
+
+InternId Event::get_channel_id() const
 {
     return this->channel_name;
 }
 
 const std::string &Event::get_city() const
+{
+    return StringInterner::instance().lookup(this->city);
+}
+
+InternId Event::get_city_id() const
 {
     return this->city;
 }
 
 const std::string &Event::get_name() const
+{
+    return StringInterner::instance().lookup(this->name);
+}
+
+InternId Event::get_name_id() const
 {
     return this->name;
 }
@@ -52,71 +81,210 @@ int Event::get_date_time() const
     return this->date_time;
 }
 
-const std::map<std::string, std::string> &Event::get_general_information() const
+const GeneralInformation &Event::get_general_information() const
 {
     return this->general_information;
 }
 
-const std::string &Event::get_description() const
+StringRef Event::get_description() const
 {
-    return this->description;
+    return frame ? frame->view(descriptionOffset, descriptionLength) : StringRef();
 }
 
-Event::Event(const std::string &frame_body): channel_name(""), city(""), 
-                                             name(""), date_time(0), description(""), general_information(),
-                                             eventOwnerUser("")
+std::size_t Event::memoryUsage() const
 {
-    stringstream ss(frame_body);
-    string line;
-    string eventDescription;
-    map<string, string> general_information_from_string;
-    bool inGeneralInformation = false;
-    while(getline(ss,line,'\n')){
-        vector<string> lineArgs;
-        if(line.find(':') != string::npos) {
-            KeyboardInput::split_str(line, ':', lineArgs);
-            string key = lineArgs.at(0);
-            string val;
-            if(lineArgs.size() == 2) {
-                val = lineArgs.at(1);
-            }
-            if(key == "user") {
-                eventOwnerUser = val;
-            }
-            if(key == "channel name") {
-                channel_name = val;
-            }
-            if(key == "city") {
-                city = val;
-            }
-            else if(key == "event name") {
-                name = val;
-            }
-            else if(key == "date time") {
-                date_time = std::stoi(val);
-            }
-            else if(key == "general information") {
-                inGeneralInformation = true;
-                continue;
-            }
-            else if(key == "description") {
-                while(getline(ss,line,'\n')) {
-                    eventDescription += line + "\n";
-                }
-                description = eventDescription;
+    std::size_t bytes = general_information.memoryUsage();
+    if (frame && frame->external()) {
+        bytes += descriptionLength; // Shared mapping, only the event's own bytes are counted
+    } else if (frame) {
+        bytes += sizeof(FrameBuffer) + frame->size() + 1;
+    }
+    return bytes;
+}
+
+bool Event::hasExternalStorage() const
+{
+    return frame && frame->external();
+}
+
+void Event::moveDescription(const FrameRef &storage, const StringRef &copy)
+{
+    frame = storage; // Releases the frame the event was parsed from
+    descriptionOffset = storage ? static_cast<std::uint32_t>(copy.data() - storage->data()) : 0;
+    descriptionLength = static_cast<std::uint32_t>(copy.size());
+}
+
+void Event::releaseStorage()
+{
+    frame = FrameRef();
+    descriptionOffset = 0;
+    descriptionLength = 0;
+    general_information = GeneralInformation();
+}
+
+namespace {
+
+// Splits a body line the way KeyboardInput::split_str(line, ':') does (empty tokens are
+// dropped) and returns the number of tokens, with views of the first two.
+std::size_t splitKeyValue(const StringRef &line, StringRef &key, StringRef &value) {
+    std::size_t count = 0;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i <= line.size(); i++) {
+        if (i == line.size() || line[i] == ':') {
+            if (i > start) {
+                if (count == 0) key = line.substr(start, i - start);
+                if (count == 1) value = line.substr(start, i - start);
+                count++;
             }
+            start = i + 1;
+        }
+    }
+    return count;
+}
+
+// Parses a leading integer like std::stoi, but yields 0 instead of throwing.
+int parseInt(const StringRef &text) {
+    std::size_t i = 0;
+    while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) i++;
+    bool negative = i < text.size() && text[i] == '-';
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) i++;
+    long long value = 0;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; i++) {
+        value = value * 10 + (text[i] - '0');
+    }
+    return static_cast<int>(negative ? -value : value);
+}
+
+} // namespace
+
+Event::Event(const std::string &frame_body): Event(FrameRef(FrameBuffer::create(frame_body.data(), frame_body.size())))
+{
+}
+
+Event::Event(const FrameRef &whole_body): Event(whole_body, StringRef(whole_body->data(), whole_body->size()))
+{
+}
+
+Event::Event(const FrameRef &frame, const StringRef &frame_body): channel_name(StringInterner::instance().intern("")),
+                                             city(channel_name), name(channel_name), date_time(0),
+                                             frame(frame), descriptionOffset(0), descriptionLength(0),
+                                             general_information(), eventOwnerUser(channel_name)
+{
+    StringInterner &interner = StringInterner::instance();
+    const char *position = frame_body.begin();
+    const char *end = frame_body.end();
+    bool inGeneralInformation = false;
+    while (position < end) {
+        const char *newline = static_cast<const char *>(std::memchr(position, '\n', end - position));
+        const char *lineEnd = newline != nullptr ? newline : end;
+        StringRef line(position, lineEnd - position);
+        position = newline != nullptr ? newline + 1 : end;
 
-            if(inGeneralInformation) {
-                general_information_from_string[key.substr(1)] = val;
+        StringRef key, val;
+        std::size_t tokens = line.find(':') == std::string::npos ? 0 : splitKeyValue(line, key, val);
+        if (tokens == 0) {
+            continue;
+        }
+        if (tokens != 2) {
+            val = StringRef();
+        }
+        if(key == "user") {
+            eventOwnerUser = interner.intern(val.data(), val.size());
+        }
+        if(key == "channel name") {
+            channel_name = interner.intern(val.data(), val.size());
+        }
+        if(key == "city") {
+            city = interner.intern(val.data(), val.size());
+        }
+        else if(key == "event name") {
+            name = interner.intern(val.data(), val.size());
+        }
+        else if(key == "date time") {
+            date_time = parseInt(val);
+        }
+        else if(key == "general information") {
+            inGeneralInformation = true;
+            continue;
+        }
+        else if(key == "description") {
+            // The description runs to the end of the body. Reading it line by line used to end it
+            // with a newline even when the body did not. The frame may already be shared, so such a
+            // description is copied with the newline added (the server always sends one).
+            std::size_t length = end - position;
+            if (length > 0 && end[-1] != '\n') {
+                FrameRef copy(FrameBuffer::allocate(length + 1));
+                std::memcpy(copy->mutableData(), position, length);
+                copy->mutableData()[length] = '\n';
+                this->frame = copy;
+                descriptionOffset = 0;
+                descriptionLength = static_cast<std::uint32_t>(length + 1);
+                break;
             }
+            descriptionOffset = static_cast<std::uint32_t>(position - frame->data());
+            descriptionLength = static_cast<std::uint32_t>(length);
+            break;
+        }
+
+        if(inGeneralInformation) {
+            general_information.set(key.substr(1), val);
         }
     }
-    general_information = general_information_from_string;
+}
+
+// converts one event object of an events file
+static Event parseEventObject(const json &event, const std::string &channel_name)
+{
+    std::string name = event["event_name"];
+    std::string city = event["city"];
+    int date_time = event["date_time"];
+    std::string description = event["description"];
+    GeneralInformation general_information;
+    for (auto &update : event["general_information"].items())
+    {
+        if (update.value().is_string())
+            general_information.set(update.key(), update.value().get<std::string>());
+        else
+            general_information.set(update.key(), update.value().dump());
+    }
+
+    Event parsed(channel_name, city, name, date_time, description, general_information);
+    if (event.contains("user"))
+        parsed.setEventOwnerUser(event["user"].get<std::string>()); // optional reporting user, kept by tools
+    return parsed;
+}
+
+static bool endsWith(const std::string &text, const std::string &suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
 }
 
 names_and_events parseEventsFile(std::string json_path)
 {
     std::ifstream f(json_path);
+
+    // NDJSON: a {"channel_name": ...} line, then one event object per line, parsed as read
+    if (endsWith(json_path, ".ndjson") || endsWith(json_path, ".jsonl"))
+    {
+        names_and_events events_and_names{"", {}};
+        std::string line;
+        bool header = true;
+        while (std::getline(f, line))
+        {
+            if (line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+            json record = json::parse(line);
+            if (header)
+            {
+                events_and_names.channel_name = record["channel_name"];
+                header = false;
+                continue;
+            }
+            events_and_names.events.push_back(parseEventObject(record, events_and_names.channel_name));
+        }
+        return events_and_names;
+    }
+
     json data = json::parse(f);
 
     std::string channel_name = data["channel_name"];
@@ -125,22 +293,27 @@ names_and_events parseEventsFile(std::string json_path)
     std::vector<Event> events;
     for (auto &event : data["events"])
     {
-        std::string name = event["event_name"];
-        std::string city = event["city"];
-        int date_time = event["date_time"];
-        std::string description = event["description"];
-        std::map<std::string, std::string> general_information;
-        for (auto &update : event["general_information"].items())
-        {
-            if (update.value().is_string())
-                general_information[update.key()] = update.value();
-            else
-                general_information[update.key()] = update.value().dump();
-        }
-
-        events.push_back(Event(channel_name, city, name, date_time, description, general_information));
+        events.push_back(parseEventObject(event, channel_name));
     }
     names_and_events events_and_names{channel_name, events};
 
     return events_and_names;
-}
\ No newline at end of file
+}
+
+std::string formatEventBody(const std::string &user, const Event &event)
+{
+    std::string body = "user:" + user + "\n" +
+                       "city:" + event.get_city() + "\n" +
+                       "event name:" + event.get_name() + "\n" +
+                       "date time:" + std::to_string(event.get_date_time()) + "\n" +
+                       "general information:\n";
+
+    event.get_general_information().forEach([&body](const std::string &key, const std::string &value) {
+        body += " " + key + ":" + value + "\n";
+    });
+
+    body += "description:\n";
+    body += event.get_description();
+    body += "\n";
+    return body;
+}
@@ -224,6 +224,7 @@ public class StompMessagingProtocolImpl implements StompMessagingProtocol<StompF
      * - Each MESSAGE must include:
      * 1. The correct `subscriptionId` for the receiving client.
      * 2. A unique `message-id` generated by the server.
+     * 3. The sender's `timestamp` header, if the SEND had one.
      * - Sends an ERROR if the sender is not subscribed.
      */
 
@@ -249,6 +250,7 @@ public class StompMessagingProtocolImpl implements StompMessagingProtocol<StompF
         }
 
         int messageId = connections.getNextMessageId(); // Generate unique message ID
+        String timestamp = message.getHeader("timestamp"); // Optional send time, for end-to-end latency
 
         // Send MESSAGE frame to all subscribers, including their unique subscriptionId
         Map<Integer, Integer> subscribers = connections.getSubscribers(topic);
@@ -262,6 +264,9 @@ public class StompMessagingProtocolImpl implements StompMessagingProtocol<StompF
             headers.put("destination", topic);
             headers.put("subscription", String.valueOf(subscriptionId)); // Include subscription ID
             headers.put("message-id", String.valueOf(messageId)); // Include unique message ID
+            if (timestamp != null) {
+                headers.put("timestamp", timestamp); // Forwarded unchanged
+            }
 
             StompFrame messageFrame = new StompFrame("MESSAGE", headers, message.getBody());
             connections.send(subscriberConnectionId, messageFrame);